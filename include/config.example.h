@@ -21,12 +21,64 @@
 // API endpoint
 #define ADSB_API_URL "https://api.adsb.lol/v2/point"
 
+// Route lookup (origin/destination) endpoint, cache size and TTL
+#define ROUTE_API_URL "https://api.adsb.lol/api/0/routeset"
+#define ROUTE_CACHE_SIZE 300  // at least MAX_AIRCRAFT, or routes are re-fetched every cycle
+#define ROUTE_CACHE_TTL_MS 3600000  // 1 hour
+
+// Request gzip-compressed API responses (1 = on, 0 = off)
+// Bodies are inflated on the fly; each fetch logs wire bytes, body bytes,
+// inflate time and peak heap, so set 0 to compare against plain responses
+#define HTTP_GZIP 1
+
 // Update interval in milliseconds
 #define UPDATE_INTERVAL_MS 30000  // 30 seconds
 
-// Full display refresh interval (every N updates)
-// Partial refresh is faster but can leave ghosting; full refresh clears it
-#define FULL_REFRESH_INTERVAL 15
+// WiFi reconnect: per-attempt association timeout, and number of
+// consecutive failed attempts before the board restarts
+#define WIFI_CONNECT_TIMEOUT_MS 10000
+#define WIFI_MAX_RECONNECT_ATTEMPTS 12
+
+// Fast boot: the first connection after boot goes straight to the AP
+// (BSSID/channel) used last time and, if set, reuses its DHCP lease; if
+// that fails within 3 s the next attempt scans and runs DHCP as usual.
+// A lease is reused only within FAST_BOOT_LEASE_S of the last good fetch
+// (keep it at or below the router's lease time), never after power-on, and
+// DHCP takes over after the first fetch
+#define FAST_BOOT_REUSE_LEASE 1
+#define FAST_BOOT_LEASE_S 3600
+
+// Traffic history log (LittleFS): raw fixes are kept this many hours before
+// being compacted into hourly summaries, or earlier if the raw log exceeds
+// HISTORY_MAX_RAW_BYTES (pages are dropped if the current hour alone does).
+// Each cycle logs at most HISTORY_MAX_FIXES aircraft, in display order.
+#define HISTORY_RETENTION_HOURS 24
+#define HISTORY_MAX_RAW_BYTES (768 * 1024)
+#define HISTORY_MAX_FIXES 100
+
+// Display order: 0 = nearest first, 1 = closest predicted approach (CPA)
+// first, so an aircraft heading for you ranks above a nearer one leaving.
+// The CPA is predicted CPA_HORIZON_S seconds ahead from ground speed and
+// track. Switch at runtime with the "order" serial command.
+#define DISPLAY_ORDER_CPA 0
+#define CPA_HORIZON_S 600
+
+// Paged aircraft list: 5 aircraft per page, auto-cycled every
+// PAGE_FLIP_INTERVAL_MS (0 = never). Uncomment PAGE_BUTTON_PIN to flip pages
+// with a button to GND (GPIO9 is the XIAO's BOOT button). The first
+// PAGE_CACHE_PAGES pages are pre-rendered (~12 KB of static RAM each).
+#define PAGE_FLIP_INTERVAL_MS 10000
+// #define PAGE_BUTTON_PIN 9
+#define PAGE_CACHE_PAGES 4
+
+// Ghosting budget
+// Partial refresh is faster but can leave ghosting; full refresh clears it.
+// The screen is split into 6 horizontal bands. A band is cleaned once the
+// pixels toggled in it since its last clean reach GHOST_BUDGET_PERCENT of
+// its pixel count; if GHOST_FULL_REFRESH_REGIONS bands are due at once, the
+// whole screen gets a full refresh instead.
+#define GHOST_BUDGET_PERCENT 60
+#define GHOST_FULL_REFRESH_REGIONS 3
 
 // E-ink display pins for XIAO ESP32-C6
 // SPI uses hardware pins: SCK=D8/GPIO19, MOSI=D10/GPIO18
@@ -1,23 +1,83 @@
 #ifndef AIRCRAFT_H
 #define AIRCRAFT_H
 
-#define MAX_AIRCRAFT 20
+#include <stdint.h>
+#include <ctype.h>
 
+#define MAX_AIRCRAFT 300
+
+// Altitude is stored in 25 ft units (the ADS-B baro altitude step)
+#define ALT_UNIT_FT 25
+
+// Aircraft flags
+#define AC_SPEED_ESTIMATED 0x01  // groundSpeed is from IAS/TAS, not gs
+#define AC_HEADING_VALID   0x02  // heading is known
+
+// Cold per-aircraft data (40 bytes). Strings are 6-bit packed, angles are
+// binary (256 = 360 degrees), position is fixed point.
 struct Aircraft {
-    char callsign[12];
-    char registration[12];
-    char type[8];
-    int altitude;
-    int verticalRate;  // baro_rate: positive = climbing, negative = descending
-    int groundSpeed;
-    bool speedEstimated; // true when using IAS/TAS fallback instead of ground speed
-    float distance;
-    float bearing;     // degrees (0-359) from observer to aircraft
-    int heading;       // aircraft track in degrees, -1 if unknown
+    uint64_t callsign;       // up to 8 chars, packString()
+    uint64_t registration;   // up to 10 chars
+    int32_t lat;             // 1e-5 degrees
+    int32_t lon;
+    uint32_t icao : 24;      // ICAO address, 0 if unknown
+    uint32_t flags : 8;
+    uint32_t type;           // up to 4 chars
+    int16_t altitude;        // ALT_UNIT_FT units
+    int16_t verticalRate;    // baro_rate ft/min: positive = climbing, negative = descending
+    uint16_t groundSpeed;    // knots
+    uint8_t bearing;         // binary angle from observer to aircraft
+    uint8_t heading;         // binary angle of track, see AC_HEADING_VALID
+};
+
+// Hot sort key, kept in its own contiguous array so sorting and filtering
+// never touch the cold records
+struct AircraftKey {
+    uint16_t distance;       // hundredths of a nautical mile
+    uint16_t index;          // into aircraftList
 };
 
 // Shared aircraft data
 extern Aircraft aircraftList[MAX_AIRCRAFT];
+extern AircraftKey aircraftOrder[MAX_AIRCRAFT];  // sorted by distance
 extern int aircraftCount;
 
+// --- Packing helpers ---
+
+// 6-bit alphabet; code 0 terminates the string
+static const char packCharset[] = "\0ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-?";
+#define PACK_UNKNOWN 38  // '?'
+
+inline uint64_t packString(const char* s, int maxChars) {
+    uint64_t v = 0;
+    for (int i = 0; i < maxChars && s[i]; i++) {
+        char c = toupper(s[i]);
+        uint64_t code = PACK_UNKNOWN;
+        if (c >= 'A' && c <= 'Z') code = 1 + (c - 'A');
+        else if (c >= '0' && c <= '9') code = 27 + (c - '0');
+        else if (c == '-') code = 37;
+        v |= code << (6 * i);
+    }
+    return v;
+}
+
+// buf must hold maxChars + 1 bytes
+inline void unpackString(uint64_t v, char* buf, int maxChars) {
+    int i = 0;
+    for (; i < maxChars; i++) {
+        int code = (v >> (6 * i)) & 0x3F;
+        if (code == 0) break;
+        buf[i] = packCharset[code];
+    }
+    buf[i] = '\0';
+}
+
+inline uint8_t degreesToAngle(float degrees) {
+    return (uint8_t)(int)(degrees * (256.0f / 360.0f) + 0.5f);
+}
+
+inline float angleToDegrees(uint8_t angle) {
+    return angle * (360.0f / 256.0f);
+}
+
 #endif
@@ -1,24 +1,61 @@
 #include "api.h"
 #include "aircraft.h"
 #include "config.h"
+#include "cpa.h"
+#include "inflate.h"
+#include "scheduler.h"
 #include "serial.h"
 
 #include <WiFi.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <math.h>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Request gzip-compressed responses (inflated on the fly while parsing)
+#ifndef HTTP_GZIP
+#define HTTP_GZIP 1
+#endif
+
+// Display order: 0 = nearest first, 1 = closest predicted approach first
+#ifndef DISPLAY_ORDER_CPA
+#define DISPLAY_ORDER_CPA 0
+#endif
+
+// How far ahead the closest approach is predicted, in seconds
+#ifndef CPA_HORIZON_S
+#define CPA_HORIZON_S 600
+#endif
 
 // Shared aircraft data
 Aircraft aircraftList[MAX_AIRCRAFT];
+AircraftKey aircraftOrder[MAX_AIRCRAFT];
+AircraftCpa aircraftCpa[MAX_AIRCRAFT];
 int aircraftCount = 0;
 
+static const CpaObserver observer = cpaObserver(LATITUDE, LONGITUDE, CPA_HORIZON_S);
+static bool orderByCpa = DISPLAY_ORDER_CPA;
+
 // API state
 String lastError = "";
+ParseTiming parseTiming = {};
 unsigned long long apiTimestamp = 0;
 
 // Weather data
 WeatherData weather = {0, 0, 0, "", false};
 
+static SemaphoreHandle_t dataLock = xSemaphoreCreateMutex();
+
+void lockAircraftData() {
+    xSemaphoreTake(dataLock, portMAX_DELAY);
+}
+
+void unlockAircraftData() {
+    xSemaphoreGive(dataLock);
+}
+
 static float calculateDistance(float lat1, float lon1, float lat2, float lon2) {
     // Haversine formula - returns distance in nautical miles
     float dLat = radians(lat2 - lat1);
@@ -40,56 +77,59 @@ static float calculateBearing(float lat1, float lon1, float lat2, float lon2) {
     return bearing;
 }
 
-bool fetchAircraftData() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi not connected");
-        lastError = "WiFi disconnected";
-        return false;
-    }
-
-    HTTPClient http;
-    String url = String(ADSB_API_URL) + "/" +
-                 String(LATITUDE, 6) + "/" +
-                 String(LONGITUDE, 6) + "/" +
-                 String(RADIUS_NM);
-
-    Serial.print("Fetching: ");
-    Serial.println(url);
+// Call before GET(): offers gzip and keeps Content-Encoding for bodyIsGzip()
+static void requestCompression(HTTPClient& http) {
+    static const char* headerKeys[] = {"Content-Encoding"};
+    http.collectHeaders(headerKeys, 1);
+#if HTTP_GZIP
+    http.addHeader("Accept-Encoding", "gzip");
+#endif
+}
 
-    http.begin(url);
-    http.addHeader("Accept", "application/json");
-    http.addHeader("User-Agent", "ESP32-ADSB-Display/1.0 (github.com/mcm69/adsb-display)");
+static bool bodyIsGzip(HTTPClient& http) {
+    return http.header("Content-Encoding").equalsIgnoreCase("gzip");
+}
 
-    int httpCode = http.GET();
+bool parseAircraftData(BodyStream& body) {
+    parseTiming = {};
 
-    if (httpCode != 200) {
-        Serial.printf("HTTP error: %d\n", httpCode);
-        lastError = "HTTP " + String(httpCode);
-        http.end();
-        return false;
+    // Keep only the fields we use, so large responses stay small in RAM
+    JsonDocument filter;
+    filter["now"] = true;
+    JsonObject f = filter["ac"][0].to<JsonObject>();
+    for (const char* key : {"hex", "flight", "r", "t", "category", "type",
+                            "alt_baro", "alt_geom", "baro_rate", "geom_rate",
+                            "gs", "tas", "ias", "lat", "lon", "track"}) {
+        f[key] = true;
     }
 
-    String payload = http.getString();
-    http.end();
-
-    // Parse JSON
+    unsigned long start = micros();
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload);
+    DeserializationError error = deserializeJson(doc, body,
+        DeserializationOption::Filter(filter));
+    parseTiming.parseUs = micros() - start;
 
     if (error) {
         Serial.print("JSON parse error: ");
         Serial.println(error.c_str());
-        lastError = "JSON parse error";
+        lastError = error == DeserializationError::NoMemory ? "Out of memory" : "JSON parse error";
+        return false;
+    }
+    // A corrupt gzip body can still parse; don't publish it
+    if (!body.finish()) {
+        lastError = "Bad gzip body";
         return false;
     }
 
-    // Extract aircraft data
+    // Extract aircraft data; the loop task may be drawing the old list
+    lockAircraftData();
+    start = micros();
     aircraftCount = 0;
     JsonArray ac = doc["ac"];
+    parseTiming.records = ac.size();
 
     for (JsonObject aircraft : ac) {
         if (aircraftCount >= MAX_AIRCRAFT) break;
-
         // Filter out ground vehicles (category C1, C2, C3)
         const char* category = aircraft["category"] | "";
         if (category[0] == 'C') continue;
@@ -99,76 +139,181 @@ bool fetchAircraftData() {
         if (strcmp(msgType, "adsb_icao_nt") == 0) continue;
 
         // Skip records with no registration and no aircraft type
-        const char* reg_check = aircraft["r"] | "";
-        const char* type_check = aircraft["t"] | "";
-        if (!reg_check[0] && !type_check[0]) continue;
+        const char* reg = aircraft["r"] | "";
+        const char* type = aircraft["t"] | "";
+        if (!reg[0] && !type[0]) continue;
 
         Aircraft& a = aircraftList[aircraftCount];
 
-        // Flight number / callsign
-        const char* cs = aircraft["flight"] | "";
-        strncpy(a.callsign, cs, sizeof(a.callsign) - 1);
-        a.callsign[sizeof(a.callsign) - 1] = '\0';
-        // Trim trailing whitespace
-        for (int i = strlen(a.callsign) - 1; i >= 0 && a.callsign[i] == ' '; i--) {
-            a.callsign[i] = '\0';
+        // ICAO address ("~" prefix marks non-ICAO/TIS-B addresses)
+        const char* hex = aircraft["hex"] | "";
+        if (hex[0] == '~') hex++;
+        a.icao = strtoul(hex, nullptr, 16) & 0xFFFFFF;
+        a.flags = 0;
+
+        // Flight number / callsign (packing stops at the trailing spaces)
+        char cs[9];
+        strncpy(cs, aircraft["flight"] | "", sizeof(cs) - 1);
+        cs[sizeof(cs) - 1] = '\0';
+        for (int i = strlen(cs) - 1; i >= 0 && cs[i] == ' '; i--) {
+            cs[i] = '\0';
         }
+        a.callsign = packString(cs, 8);
 
-        // Registration
-        const char* reg = aircraft["r"] | "";
-        strncpy(a.registration, reg, sizeof(a.registration) - 1);
-        a.registration[sizeof(a.registration) - 1] = '\0';
-
-        // Aircraft type
-        const char* type = aircraft["t"] | "";
-        strncpy(a.type, type, sizeof(a.type) - 1);
-        a.type[sizeof(a.type) - 1] = '\0';
+        // Registration and aircraft type
+        a.registration = packString(reg, 10);
+        a.type = packString(type, 4);
 
         // Altitude and vertical rate
-        a.altitude = aircraft["alt_baro"] | aircraft["alt_geom"] | 0;
-        a.verticalRate = aircraft["baro_rate"] | aircraft["geom_rate"] | 0;
+        int altitude = aircraft["alt_baro"] | aircraft["alt_geom"] | 0;
+        int half = ALT_UNIT_FT / 2;  // round to the nearest unit, not toward zero
+        a.altitude = constrain((altitude + (altitude >= 0 ? half : -half)) / ALT_UNIT_FT,
+                               INT16_MIN, INT16_MAX);
+        int verticalRate = aircraft["baro_rate"] | aircraft["geom_rate"] | 0;
+        a.verticalRate = constrain(verticalRate, INT16_MIN, INT16_MAX);
 
         // Ground speed with fallback to TAS/IAS
         float gs = aircraft["gs"] | 0.0f;
         if (gs > 0) {
-            a.groundSpeed = (int)round(gs);
-            a.speedEstimated = false;
+            a.groundSpeed = lroundf(fminf(gs, 65535.0f));
         } else {
             float fallback = aircraft["tas"] | aircraft["ias"] | 0.0f;
-            a.groundSpeed = (int)round(fallback);
-            a.speedEstimated = (a.groundSpeed > 0);
+            a.groundSpeed = fallback > 0 ? lroundf(fminf(fallback, 65535.0f)) : 0;
+            if (a.groundSpeed > 0) a.flags |= AC_SPEED_ESTIMATED;
         }
 
-        // Distance and bearing from observer
+        // Distance and bearing from observer; drop impossible positions
         float lat = aircraft["lat"] | 0.0f;
         float lon = aircraft["lon"] | 0.0f;
-        a.distance = calculateDistance(LATITUDE, LONGITUDE, lat, lon);
-        a.bearing = calculateBearing(LATITUDE, LONGITUDE, lat, lon);
+        if (!(fabsf(lat) <= 90 && fabsf(lon) <= 180)) continue;
+        a.lat = lroundf(lat * 1e5f);
+        a.lon = lroundf(lon * 1e5f);
+        unsigned long geometryStart = micros();
+        float distance = calculateDistance(LATITUDE, LONGITUDE, lat, lon);
+        a.bearing = degreesToAngle(calculateBearing(LATITUDE, LONGITUDE, lat, lon));
+        parseTiming.geometryUs += micros() - geometryStart;
 
         // Aircraft heading (track over ground)
-        a.heading = aircraft["track"].is<float>() ? (int)round((float)aircraft["track"]) : -1;
+        if (aircraft["track"].is<float>()) {
+            a.heading = degreesToAngle(aircraft["track"].as<float>());
+            a.flags |= AC_HEADING_VALID;
+        }
 
+        aircraftOrder[aircraftCount].distance = min(distance * 100.0f, 65535.0f);
+        aircraftOrder[aircraftCount].index = aircraftCount;
         aircraftCount++;
     }
 
-    // Sort by distance
-    for (int i = 0; i < aircraftCount - 1; i++) {
-        for (int j = i + 1; j < aircraftCount; j++) {
-            if (aircraftList[j].distance < aircraftList[i].distance) {
-                Aircraft temp = aircraftList[i];
-                aircraftList[i] = aircraftList[j];
-                aircraftList[j] = temp;
-            }
-        }
-    }
+    parseTiming.filterUs = micros() - start - parseTiming.geometryUs;
+
+    // Closest approach for every aircraft in one pass
+    start = micros();
+    computeCpa(observer, aircraftList, aircraftCount, aircraftCpa);
+    parseTiming.cpaUs = micros() - start;
+
+    int approaching = 0;
+    for (int i = 0; i < aircraftCount; i++) approaching += aircraftCpa[i].time > 0;
+
+    start = micros();
+    sortAircraft();
+    parseTiming.sortUs = micros() - start;
 
     // Store API timestamp
     apiTimestamp = doc["now"] | 0ULL;
+    unlockAircraftData();
 
+    Serial.printf("CPA: %d aircraft in %lu us, %d approaching\n",
+        aircraftCount, parseTiming.cpaUs, approaching);
+    Serial.printf("Sorted %d aircraft by %s in %lu us (%u bytes each)\n",
+        aircraftCount, orderByCpa ? "CPA" : "distance", parseTiming.sortUs,
+        (unsigned)(sizeof(Aircraft) + sizeof(AircraftKey) + sizeof(AircraftCpa)));
     Serial.printf("Found %d aircraft\n", aircraftCount);
     return true;
 }
 
+// Only the 4-byte keys move; the CPA order breaks ties by distance
+void sortAircraft() {
+    if (orderByCpa) {
+        std::sort(aircraftOrder, aircraftOrder + aircraftCount,
+            [](const AircraftKey& x, const AircraftKey& y) {
+                uint16_t mx = aircraftCpa[x.index].miss;
+                uint16_t my = aircraftCpa[y.index].miss;
+                return mx != my ? mx < my : x.distance < y.distance;
+            });
+    } else {
+        std::sort(aircraftOrder, aircraftOrder + aircraftCount,
+            [](const AircraftKey& x, const AircraftKey& y) { return x.distance < y.distance; });
+    }
+}
+
+bool orderCommand(const char* line) {
+    if (strncmp(line, "order", 5) != 0 || (line[5] && line[5] != ' ')) return false;
+    const char* arg = line + 5;
+    while (*arg == ' ') arg++;
+
+    if (strcmp(arg, "cpa") == 0) {
+        orderByCpa = true;
+    } else if (strcmp(arg, "distance") == 0) {
+        orderByCpa = false;
+    } else if (*arg) {
+        Serial.println("Usage: order [distance|cpa]");
+        return true;
+    }
+    if (*arg) {
+        lockAircraftData();
+        sortAircraft();
+        unlockAircraftData();
+        postEvent(EV_RENDER);
+    }
+    Serial.printf("Display order: %s\n", orderByCpa ? "CPA" : "distance");
+    return true;
+}
+
+bool fetchAircraftData() {
+    if (WiFi.status() != WL_CONNECTED) {
+        Serial.println("WiFi not connected");
+        lastError = "WiFi disconnected";
+        return false;
+    }
+
+    HTTPClient http;
+    String url = String(ADSB_API_URL) + "/" +
+                 String(LATITUDE, 6) + "/" +
+                 String(LONGITUDE, 6) + "/" +
+                 String(RADIUS_NM);
+
+    Serial.print("Fetching: ");
+    Serial.println(url);
+
+    http.begin(url);
+    http.useHTTP10(true);  // no chunked encoding, so the body can be streamed
+    http.addHeader("Accept", "application/json");
+    http.addHeader("User-Agent", "ESP32-ADSB-Display/1.0 (github.com/mcm69/adsb-display)");
+    requestCompression(http);
+
+    int httpCode = http.GET();
+
+    if (httpCode != 200) {
+        Serial.printf("HTTP error: %d\n", httpCode);
+        lastError = "HTTP " + String(httpCode);
+        http.end();
+        return false;
+    }
+
+    // Parse JSON straight from the socket
+    BodyStream body(http.getStream(), bodyIsGzip(http));
+    if (!body.ok()) {
+        Serial.println("Out of memory for inflate buffers");
+        lastError = "Out of memory";
+        http.end();
+        return false;
+    }
+    bool parsed = parseAircraftData(body);
+    http.end();
+    body.printStats("Aircraft fetch");
+    return parsed;
+}
+
 bool fetchWeatherData() {
     if (WiFi.status() != WL_CONNECTED) {
         return false;
@@ -182,7 +327,9 @@ bool fetchWeatherData() {
     Serial.println(url);
 
     http.begin(url);
+    http.useHTTP10(true);
     http.addHeader("User-Agent", "ESP32-ADSB-Display/1.0 (github.com/mcm69/adsb-display)");
+    requestCompression(http);
 
     int httpCode = http.GET();
 
@@ -192,9 +339,20 @@ bool fetchWeatherData() {
         return false;
     }
 
-    String payload = http.getString();
+    BodyStream body(http.getStream(), bodyIsGzip(http));
+    if (!body.ok()) {
+        Serial.println("Out of memory for inflate buffers");
+        http.end();
+        return false;
+    }
+    bool parsed = parseWeatherData(body);
     http.end();
+    body.printStats("Weather fetch");
+
+    return parsed;
+}
 
+bool parseWeatherData(BodyStream& body) {
     // Parse JSON - met.no response is large, filter to reduce memory
     JsonDocument filter;
     filter["properties"]["timeseries"][0]["data"]["instant"]["details"]["air_temperature"] = true;
@@ -203,18 +361,20 @@ bool fetchWeatherData() {
     filter["properties"]["timeseries"][0]["data"]["next_1_hours"]["summary"]["symbol_code"] = true;
 
     JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload, DeserializationOption::Filter(filter));
+    DeserializationError error = deserializeJson(doc, body, DeserializationOption::Filter(filter));
 
     if (error) {
         Serial.print("Weather JSON parse error: ");
         Serial.println(error.c_str());
         return false;
     }
+    if (!body.finish()) return false;
 
     // Get current conditions (first timeseries entry)
     JsonObject current = doc["properties"]["timeseries"][0]["data"];
     JsonObject instant = current["instant"]["details"];
 
+    lockAircraftData();
     weather.temperature = instant["air_temperature"] | 0.0f;
     weather.windSpeed = instant["wind_speed"] | 0.0f;
     weather.windDirection = instant["wind_from_direction"] | 0.0f;
@@ -224,6 +384,7 @@ bool fetchWeatherData() {
     weather.symbol[sizeof(weather.symbol) - 1] = '\0';
 
     weather.valid = true;
+    unlockAircraftData();
 
     Serial.printf("Weather: %.1fC, %.1fm/s from %.0f, %s\n",
         weather.temperature, weather.windSpeed, weather.windDirection, weather.symbol);
@@ -3,14 +3,45 @@
 
 #include <Arduino.h>
 
+class BodyStream;
+
 // Fetch aircraft data from ADS-B API
 // Returns true on success, false on failure
 bool fetchAircraftData();
 
+// Parse an adsb.lol response body into aircraftList/aircraftOrder
+// Used by fetchAircraftData(); also fed synthetic payloads by the benchmark
+// Returns true on success; on failure lastError is set. Nothing is
+// published unless the whole body, gzip trailer included, checks out
+bool parseAircraftData(BodyStream& body);
+
+// Stage timings of the last parseAircraftData() call
+struct ParseTiming {
+    unsigned long parseUs;     // deserializeJson, including reading the stream
+    unsigned long filterUs;    // record filtering and field extraction
+    unsigned long geometryUs;  // distance and bearing
+    unsigned long cpaUs;       // closest point of approach
+    unsigned long sortUs;
+    int records;               // entries in the "ac" array
+};
+
+extern ParseTiming parseTiming;
+
+// Sort aircraftOrder by the selected display order (distance or CPA)
+void sortAircraft();
+
+// Serial command: "order", "order distance", "order cpa"
+// Returns false if the line is not an order command
+bool orderCommand(const char* line);
+
 // Fetch weather data from met.no API
 // Returns true on success, false on failure
 bool fetchWeatherData();
 
+// Parse a met.no locationforecast body into weather
+// Used by fetchWeatherData(); also fed recorded bodies by the benchmark
+bool parseWeatherData(BodyStream& body);
+
 // Last error message (for display)
 extern String lastError;
 
@@ -28,4 +59,10 @@ struct WeatherData {
 
 extern WeatherData weather;
 
+// Fetches run on the worker task while the loop task draws. Hold this lock
+// while reading aircraftList/aircraftOrder/aircraftCpa/aircraftCount,
+// apiTimestamp or weather from any other task; writers take it too.
+void lockAircraftData();
+void unlockAircraftData();
+
 #endif
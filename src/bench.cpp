@@ -0,0 +1,204 @@
+#include "bench.h"
+#include "aircraft.h"
+#include "api.h"
+#include "config.h"
+#include "cpa.h"
+#include "display.h"
+#include "inflate.h"
+#include "scheduler.h"
+#include "serial.h"
+
+// Longest pause in the payload before the parse gives up
+#define BENCH_READ_TIMEOUT_MS 5000
+
+// The next `length` bytes of a stream, then end of stream. Counts the time
+// spent waiting for the host, so it can be taken out of the CPU figure.
+class LimitedStream : public Stream {
+public:
+    LimitedStream(Stream& source, size_t length) : source(source), remaining(length) {}
+
+    int available() override { return min((size_t)source.available(), remaining); }
+    int peek() override { return remaining ? source.peek() : -1; }
+    size_t write(uint8_t) override { return 0; }
+
+    int read() override {
+        char c;
+        return readBytes(&c, 1) ? (uint8_t)c : -1;
+    }
+
+    size_t readBytes(char* buffer, size_t length) override {
+        if (length > remaining) length = remaining;
+        if (length == 0) return 0;
+        unsigned long start = micros();
+        size_t n = source.readBytes(buffer, length);
+        waitUs += micros() - start;
+        remaining -= n;
+        if (n < length) remaining = 0;  // host stalled, stop here
+        return n;
+    }
+
+    unsigned long waitUs = 0;
+
+private:
+    Stream& source;
+    size_t remaining;
+};
+
+// Live data, set aside while the benchmark uses the shared arrays
+struct LiveData {
+    int count;
+    unsigned long long apiTimestamp;
+    WeatherData weather;
+    Aircraft list[MAX_AIRCRAFT];
+    AircraftKey order[MAX_AIRCRAFT];
+    AircraftCpa cpa[MAX_AIRCRAFT];
+};
+
+static LiveData* live = nullptr;
+static unsigned long long benchTimestamp = 0;  // apiTimestamp the bench parsed
+
+// Runs on the worker; holds aircraft frames until restoreLiveData()
+static bool saveLiveData() {
+    live = (LiveData*)malloc(sizeof(LiveData));
+    if (!live) return false;
+    holdAircraftFrames(true);
+    lockAircraftData();
+    live->count = aircraftCount;
+    live->apiTimestamp = apiTimestamp;
+    live->weather = weather;
+    memcpy(live->list, aircraftList, sizeof(aircraftList));
+    memcpy(live->order, aircraftOrder, sizeof(aircraftOrder));
+    memcpy(live->cpa, aircraftCpa, sizeof(aircraftCpa));
+    unlockAircraftData();
+    return true;
+}
+
+// Runs on the loop task once the benchmark has rendered
+static void restoreLiveData() {
+    if (!live) return;
+    lockAircraftData();
+    weather = live->weather;
+    // Unless a real fetch queued behind the bench has already replaced it
+    if (apiTimestamp == benchTimestamp) {
+        aircraftCount = live->count;
+        apiTimestamp = live->apiTimestamp;
+        memcpy(aircraftList, live->list, sizeof(aircraftList));
+        memcpy(aircraftOrder, live->order, sizeof(aircraftOrder));
+        memcpy(aircraftCpa, live->cpa, sizeof(aircraftCpa));
+    }
+    unlockAircraftData();
+    free(live);
+    live = nullptr;
+    holdAircraftFrames(false);
+}
+
+// Parse results, handed from the worker to benchReport()
+static bool bodyRun = false;  // "bench body" rather than "bench"
+static bool parsed = false;
+static int kept = 0;
+static size_t bodyBytes = 0;
+static uint32_t heapPeak = 0;
+static char error[32];
+
+// "bench body" results
+static char bodyKind[12];
+static bool bodyGzip = false;
+static size_t wireBytes = 0;
+static unsigned long inflateUs = 0;
+static unsigned long cpuUs = 0;
+
+// Parse the next `length` bytes from the host through BodyStream and the
+// real parser. Bytes the parser leaves unread are drained, so a payload
+// that fails early is not taken as command lines.
+static void parseBody(unsigned long length, bool gzip, bool weather) {
+    Serial.setTimeout(BENCH_READ_TIMEOUT_MS);
+    LimitedStream source(Serial, length);
+    unsigned long start = micros();
+    if (!saveLiveData()) {
+        parsed = false;
+        lastError = "Out of memory";
+        wireBytes = bodyBytes = 0;
+        cpuUs = inflateUs = heapPeak = 0;
+        parseTiming = {};
+    } else {
+        BodyStream body(source, gzip);
+        if (!body.ok()) {
+            parsed = false;
+            lastError = "Out of memory";
+        } else {
+            // parseAircraftData() sets lastError itself
+            parsed = weather ? parseWeatherData(body) : parseAircraftData(body);
+            if (weather && !parsed) {
+                lastError = body.valid() ? "Bad weather JSON" : "Bad gzip body";
+            }
+        }
+        // All reads happen inside the parser
+        cpuUs = micros() - start - source.waitUs;
+        if (!weather) parseTiming.parseUs -= min(source.waitUs, parseTiming.parseUs);
+        wireBytes = body.wireSize();
+        bodyBytes = body.bodySize();
+        inflateUs = body.inflateTime();
+        heapPeak = body.peakHeap();
+    }
+    benchTimestamp = apiTimestamp;
+    char sink[64];
+    while (source.readBytes(sink, sizeof(sink)) > 0) {}
+    Serial.setTimeout(1000);
+
+    strncpy(error, parsed ? "none" : lastError.c_str(), sizeof(error) - 1);
+    error[sizeof(error) - 1] = '\0';
+}
+
+bool benchCommand(const char* line) {
+    char kind[12], encoding[12];
+    unsigned long length;
+
+    if (strcmp(line, "bench observer") == 0) {
+        Serial.printf("BENCH observer lat=%.6f lon=%.6f radius=%d\n",
+            (double)LATITUDE, (double)LONGITUDE, (int)RADIUS_NM);
+        return true;
+    }
+
+    // "bench body <aircraft|weather> <gzip|identity> <bytes>"
+    if (sscanf(line, "bench body %11s %11s %lu", kind, encoding, &length) == 3) {
+        bool weather = strcmp(kind, "weather") == 0;
+        if (!weather && strcmp(kind, "aircraft") != 0) return false;
+        strcpy(bodyKind, kind);
+        bodyGzip = strcmp(encoding, "gzip") == 0;
+        parseBody(length, bodyGzip, weather);
+        bodyRun = true;
+        postEvent(EV_BENCH_DONE);
+        return true;
+    }
+
+    // "bench <bytes>"
+    if (sscanf(line, "bench %lu", &length) != 1) return false;
+    parseBody(length, false, false);
+    kept = aircraftCount;
+    bodyRun = false;
+    postEvent(EV_BENCH_DONE);
+    return true;
+}
+
+void benchReport() {
+    if (bodyRun) {
+        Serial.printf("BODY kind=%s encoding=%s wire=%u body=%u cpu_us=%lu inflate_us=%lu "
+                      "heap_peak=%u error=%s\n",
+            bodyKind, bodyGzip ? "gzip" : "identity", (unsigned)wireBytes,
+            (unsigned)bodyBytes, cpuUs, inflateUs, (unsigned)heapPeak, error);
+        restoreLiveData();
+        return;
+    }
+
+    unsigned long renderUs = 0, composeUs = 0;
+    if (parsed) benchRender(&renderUs, &composeUs);
+    restoreLiveData();
+
+    Serial.printf("BENCH records=%d kept=%d bytes=%u parse_us=%lu filter_us=%lu "
+                  "geometry_us=%lu cpa_us=%lu sort_us=%lu render_us=%lu compose_us=%lu "
+                  "heap_peak=%u heap_free=%u error=%s\n",
+        parseTiming.records, kept, (unsigned)bodyBytes,
+        parseTiming.parseUs, parseTiming.filterUs, parseTiming.geometryUs,
+        parseTiming.cpaUs, parseTiming.sortUs, renderUs, composeUs,
+        (unsigned)heapPeak, (unsigned)ESP.getFreeHeap(), error);
+}
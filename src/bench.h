@@ -0,0 +1,33 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+// Scaling benchmark, driven from the host by tools/scaling_bench.py
+//
+// "bench <bytes>" is followed by an adsb.lol-style JSON document of that
+// many bytes (tools/gen_traffic.py). It runs through the real parse, filter,
+// geometry, CPA, sort and page render code, and one result line is printed:
+//   BENCH records=1000 kept=300 bytes=... parse_us=... ... heap_peak=...
+// parse_us leaves out time spent waiting for the host.
+// The panel is not refreshed. The live aircraft and weather are set aside
+// while a bench runs and put back afterwards; page flips and renders wait.
+// "bench observer" prints the configured position and radius, so the
+// payload can be generated around them:
+//   BENCH observer lat=51.507400 lon=-0.127800 radius=25
+//
+// "bench body <aircraft|weather> <gzip|identity> <bytes>" is followed by a
+// recorded response body of that many bytes (tools/body_bench.py). It is
+// read through BodyStream and the real parser, and one line is printed:
+//   BODY kind=aircraft encoding=gzip wire=... body=... cpu_us=... ...
+// cpu_us leaves out time spent waiting for the host. Either way, bytes the
+// parser leaves unread are drained rather than read as commands.
+
+// Runs on the worker task: reads and parses the payload, then posts
+// EV_BENCH_DONE. Returns false if the line is not a bench command.
+bool benchCommand(const char* line);
+
+// Runs on the loop task on EV_BENCH_DONE: times the render, prints the line
+void benchReport();
+
+#endif
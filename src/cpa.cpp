@@ -0,0 +1,97 @@
+#include "cpa.h"
+
+#include <math.h>
+
+// sin() over a quarter turn of binary angle (64 = 90 degrees), Q14
+static const int16_t quarterSine[65] = {
+    0, 402, 804, 1205, 1606, 2006, 2404, 2801, 3196,
+    3590, 3981, 4370, 4756, 5139, 5520, 5897, 6270, 6639,
+    7005, 7366, 7723, 8076, 8423, 8765, 9102, 9434, 9760,
+    10080, 10394, 10702, 11003, 11297, 11585, 11866, 12140, 12406,
+    12665, 12916, 13160, 13395, 13623, 13842, 14053, 14256, 14449,
+    14635, 14811, 14978, 15137, 15286, 15426, 15557, 15679, 15791,
+    15893, 15986, 16069, 16143, 16207, 16261, 16305, 16340, 16364,
+    16379, 16384,
+};
+
+static inline int32_t sineQ14(uint8_t angle) {
+    uint8_t a = angle & 63;
+    int32_t s;
+    switch (angle >> 6) {
+        case 0:  s = quarterSine[a]; break;
+        case 1:  s = quarterSine[64 - a]; break;
+        case 2:  s = -quarterSine[a]; break;
+        default: s = -quarterSine[64 - a]; break;
+    }
+    return s;
+}
+
+// Components are clamped so the sum of squares fits 32 bits
+#define CPA_MAX_COMPONENT 46340
+
+static inline int32_t clampComponent(int64_t v) {
+    if (v > CPA_MAX_COMPONENT) return CPA_MAX_COMPONENT;
+    if (v < -CPA_MAX_COMPONENT) return -CPA_MAX_COMPONENT;
+    return (int32_t)v;
+}
+
+// floor(sqrt(v)), bit by bit
+static inline uint32_t isqrt32(uint32_t v) {
+    uint32_t root = 0;
+    for (uint32_t bit = 1u << 30; bit; bit >>= 2) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+static inline uint16_t length(int32_t x, int32_t y) {
+    return isqrt32((uint32_t)(x * x) + (uint32_t)(y * y));
+}
+
+CpaObserver cpaObserver(float lat, float lon, uint16_t horizonSeconds) {
+    // 1e-5 deg of latitude = 0.0006 NM = 0.06 hundredths of NM; longitude
+    // shrinks with cos(latitude). Flat earth is plenty within a few
+    // hundred NM.
+    CpaObserver obs;
+    obs.lat = lroundf(lat * 1e5f);
+    obs.lon = lroundf(lon * 1e5f);
+    obs.yScale = lroundf(0.06f * (1 << 20));
+    obs.xScale = lroundf(0.06f * cosf(lat * (float)M_PI / 180.0f) * (1 << 20));
+    obs.horizon = horizonSeconds;
+    return obs;
+}
+
+void computeCpa(const CpaObserver& obs, const Aircraft* list, int count, AircraftCpa* out) {
+    for (int i = 0; i < count; i++) {
+        const Aircraft& a = list[i];
+
+        // Position relative to the observer, hundredths of NM (x east, y north)
+        int32_t rx = clampComponent(((int64_t)(a.lon - obs.lon) * obs.xScale) >> 20);
+        int32_t ry = clampComponent(((int64_t)(a.lat - obs.lat) * obs.yScale) >> 20);
+
+        out[i].time = 0;
+        out[i].miss = length(rx, ry);
+        if (!(a.flags & AC_HEADING_VALID) || a.groundSpeed == 0) continue;
+
+        // Velocity in knots, Q14; 1 kt = 1/36 hundredths of NM per second
+        int32_t vx = (int32_t)a.groundSpeed * sineQ14(a.heading);
+        int32_t vy = (int32_t)a.groundSpeed * sineQ14(a.heading + 64);
+
+        // Closing when r.v < 0; t = -(r.v) / (v.v), rescaled to seconds
+        int64_t dot = (int64_t)rx * vx + (int64_t)ry * vy;
+        if (dot >= 0) continue;
+        int64_t vv = ((int64_t)vx * vx + (int64_t)vy * vy) >> 14;
+        int64_t t = (-dot * 36) / vv;
+        if (t > obs.horizon) t = obs.horizon;
+
+        int32_t mx = clampComponent(rx + ((int64_t)vx * t) / (36 << 14));
+        int32_t my = clampComponent(ry + ((int64_t)vy * t) / (36 << 14));
+        out[i].time = t;
+        out[i].miss = length(mx, my);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef CPA_H
+#define CPA_H
+
+#include <stdint.h>
+#include "aircraft.h"
+
+// Closest point of approach to the observer, assuming each aircraft holds
+// its ground speed and track. Fixed point throughout, one pass over the
+// aircraft; no Arduino dependencies, so tools/cpa_bench.cpp can build it
+// on the host.
+
+// Observer position and the prediction horizon, set up once
+struct CpaObserver {
+    int32_t lat;        // 1e-5 degrees, as Aircraft::lat
+    int32_t lon;
+    int32_t xScale;     // 1e-5 deg of longitude -> hundredths of NM, Q20
+    int32_t yScale;     // 1e-5 deg of latitude  -> hundredths of NM, Q20
+    uint16_t horizon;   // seconds looked ahead
+};
+
+struct AircraftCpa {
+    uint16_t time;      // seconds to closest approach, capped at the horizon;
+                        // 0 = receding, or no speed/track (closest now)
+    uint16_t miss;      // closest distance within the horizon, hundredths of NM
+};
+
+// Per aircraft, indexed like aircraftList (defined in api.cpp)
+extern AircraftCpa aircraftCpa[MAX_AIRCRAFT];
+
+CpaObserver cpaObserver(float lat, float lon, uint16_t horizonSeconds);
+
+// Fill out[i] for list[i], i < count
+void computeCpa(const CpaObserver& obs, const Aircraft* list, int count, AircraftCpa* out);
+
+#endif
@@ -2,21 +2,158 @@
 #include "aircraft.h"
 #include "api.h"
 #include "config.h"
+#include "cpa.h"
 #include "lookup.h"
+#include "routes.h"
+#include "scheduler.h"
 #include "serial.h"
 
 #include <SPI.h>
+#include <Adafruit_GFX.h>
 #include <GxEPD2_BW.h>
 #include <U8g2_for_Adafruit_GFX.h>
 #include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 
 // Display instance for WeAct 4.2" (400x300)
-static GxEPD2_BW<GxEPD2_420_GDEY042T81, GxEPD2_420_GDEY042T81::HEIGHT> display(
+// Frames are rendered into our own canvas, so GxEPD2's page buffer is unused
+// and kept minimal
+static GxEPD2_BW<GxEPD2_420_GDEY042T81, 8> display(
     GxEPD2_420_GDEY042T81(EPD_CS, EPD_DC, EPD_RST, EPD_BUSY));
 
 static U8G2_FOR_ADAFRUIT_GFX u8g2Fonts;
 
-static int updatesSinceFullRefresh = 0;
+#define SCREEN_W 400
+#define SCREEN_H 300
+#define ROW_BYTES (SCREEN_W / 8)
+
+// Frame being drawn, and the frame last sent to the panel.
+// Both use the controller's bit order (1 = white).
+static GFXcanvas1 canvas(SCREEN_W, SCREEN_H);
+static uint8_t shownFrame[ROW_BYTES * SCREEN_H];
+
+// Paged card list: every page's card area is pre-rendered into a cached
+// bitmap when new data arrives, so flipping pages only blits it into the
+// frame. Pages past PAGE_CACHE_PAGES are drawn on demand.
+#ifndef PAGE_CACHE_PAGES
+#define PAGE_CACHE_PAGES 4
+#endif
+
+#define CARDS_PER_PAGE 5
+#define CARDS_TOP 26        // canvas rows holding the cards
+#define CARDS_BOTTOM 272
+#define CARDS_BYTES ((CARDS_BOTTOM - CARDS_TOP) * ROW_BYTES)
+
+struct CachedPage {
+    uint8_t rows[CARDS_BYTES];
+    uint32_t hash;          // hash of the displayed fields it was rendered from
+    bool valid;
+};
+
+// Static, like the frame buffers: allocating per page as the aircraft count
+// changed fragmented the heap that TLS and the inflate window need
+static CachedPage pageCache[PAGE_CACHE_PAGES];
+static int currentPage = 0;
+static bool errorShown = false;
+
+static int pageCount() {
+    return max(1, (aircraftCount + CARDS_PER_PAGE - 1) / CARDS_PER_PAGE);
+}
+
+// Ghosting budget: partial refreshes leave ghosting roughly in proportion to
+// how many pixels toggled. The screen is split into horizontal bands, each
+// allowed GHOST_BUDGET_PERCENT of its pixel count in toggles before it is
+// cleaned. Enough bands over budget at once triggers a full refresh instead.
+#ifndef GHOST_BUDGET_PERCENT
+#define GHOST_BUDGET_PERCENT 60
+#endif
+#ifndef GHOST_FULL_REFRESH_REGIONS
+#define GHOST_FULL_REFRESH_REGIONS 3
+#endif
+
+#define GHOST_REGIONS 6
+#define REGION_ROWS (SCREEN_H / GHOST_REGIONS)
+#define REGION_BUDGET ((uint32_t)SCREEN_W * REGION_ROWS * GHOST_BUDGET_PERCENT / 100)
+
+static uint32_t regionToggles[GHOST_REGIONS];
+static bool panelUnknown = true;  // contents at boot are unknown: start with a full refresh
+
+// Refresh counts per day, with the old fixed policy (full refresh every 15
+// updates and after every error screen) simulated alongside for comparison
+#define LEGACY_FULL_REFRESH_INTERVAL 15
+#define STATS_DAY_MS 86400000UL
+
+static unsigned long statsDayStart = 0;
+static int fullRefreshes = 0;
+static int regionCleans = 0;
+static int partialRefreshes = 0;
+static int legacyFullRefreshes = 0;
+static int legacyUpdatesSinceFull = LEGACY_FULL_REFRESH_INTERVAL;
+
+// Async refresh: frames are drawn on the loop task, then the display task
+// pushes them to the panel and sleeps until BUSY falls.
+enum FrameKind { FRAME_NONE, FRAME_AIRCRAFT, FRAME_ERROR };
+
+static TaskHandle_t displayTaskHandle = nullptr;
+static SemaphoreHandle_t busyReleased = nullptr;
+static volatile bool refreshInFlight = false;
+static bool refreshFull = false;
+static uint8_t refreshCleanMask = 0;  // bands to clean before a partial refresh
+
+// Latest frame requested while a refresh was in flight (at most one)
+static FrameKind pendingFrame = FRAME_NONE;
+static volatile bool framesHeld = false;  // benchmark data in aircraftList
+static int pendingFailures = 0;
+static unsigned long pendingBackoffMs = 0;
+static char pendingError[48];
+
+static void startRefresh();
+
+static void IRAM_ATTR onBusyFalling() {
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(busyReleased, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+// Called by GxEPD2 while BUSY is asserted; block instead of polling.
+// The timeout lets GxEPD2 re-check the pin and apply its own busy timeout.
+static void waitForBusy(const void*) {
+    xSemaphoreTake(busyReleased, pdMS_TO_TICKS(50));
+}
+
+static void displayTask(void*) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        unsigned long start = millis();
+        if (refreshFull) {
+            display.epd2.writeImageForFullRefresh(shownFrame, 0, 0, SCREEN_W, SCREEN_H);
+            display.epd2.refresh(false);
+        } else {
+            // Targeted clean: drive each band through its inverse, so every
+            // pixel in it toggles, before the normal partial update
+            for (int r = 0; r < GHOST_REGIONS; r++) {
+                if (!(refreshCleanMask & (1 << r))) continue;
+                int y = r * REGION_ROWS;
+                const uint8_t* rows = shownFrame + y * ROW_BYTES;
+                display.epd2.writeImage(rows, 0, y, SCREEN_W, REGION_ROWS, true);
+                display.epd2.refresh(0, y, SCREEN_W, REGION_ROWS);
+                display.epd2.writeImageAgain(rows, 0, y, SCREEN_W, REGION_ROWS, true);
+            }
+            display.epd2.writeImage(shownFrame, 0, 0, SCREEN_W, SCREEN_H);
+            display.epd2.refresh(true);
+        }
+        display.epd2.writeImageAgain(shownFrame, 0, 0, SCREEN_W, SCREEN_H);
+
+        Serial.printf("%s refresh took %lu ms\n",
+            refreshFull ? "Full" : "Partial", millis() - start);
+
+        refreshInFlight = false;
+        postEvent(EV_DISPLAY_READY);
+    }
+}
 
 // Convert degrees to cardinal direction
 static const char* degreesToCardinal(float degrees) {
@@ -94,182 +231,466 @@ void initDisplay() {
     display.init(115200);
     display.setRotation(0);
 
-    u8g2Fonts.begin(display);
+    u8g2Fonts.begin(canvas);
     u8g2Fonts.setFontMode(1);       // transparent background
     u8g2Fonts.setFontDirection(0);   // left to right
     u8g2Fonts.setForegroundColor(GxEPD_BLACK);
     u8g2Fonts.setBackgroundColor(GxEPD_WHITE);
+
+    // BUSY is high while the SSD1683 is refreshing
+    busyReleased = xSemaphoreCreateBinary();
+    display.epd2.setBusyCallback(waitForBusy);
+    attachInterrupt(digitalPinToInterrupt(EPD_BUSY), onBusyFalling, FALLING);
+
+    xTaskCreate(displayTask, "display", 4096, nullptr, 1, &displayTaskHandle);
 }
 
 void showStartupScreen() {
-    display.setFullWindow();
-    display.firstPage();
-    do {
-        display.fillScreen(GxEPD_WHITE);
-        u8g2Fonts.setFont(u8g2_font_8x13B_mf);
-        printAt(120, 150, "Starting...");
-    } while (display.nextPage());
+    canvas.fillScreen(GxEPD_WHITE);
+    u8g2Fonts.setFont(u8g2_font_8x13B_mf);
+    printAt(120, 150, "Starting...");
+    startRefresh();
 }
 
-void updateDisplayError(int consecutiveFailures, unsigned long backoffMs) {
-    display.setFullWindow();
-    updatesSinceFullRefresh = FULL_REFRESH_INTERVAL;
-    display.firstPage();
-
-    do {
-        display.fillScreen(GxEPD_WHITE);
+static void drawErrorFrame(const char* message, int consecutiveFailures, unsigned long backoffMs) {
+    canvas.fillScreen(GxEPD_WHITE);
 
-        u8g2Fonts.setFont(u8g2_font_8x13B_mf);
-        printAt(10, 25, "ADS-B Tracker");
+    u8g2Fonts.setFont(u8g2_font_8x13B_mf);
+    printAt(10, 25, "ADS-B Tracker");
 
-        display.drawLine(0, 35, 400, 35, GxEPD_BLACK);
+    canvas.drawLine(0, 35, 400, 35, GxEPD_BLACK);
 
-        u8g2Fonts.setFont(u8g2_font_8x13_mf);
-        printAt(10, 70, "Request failed:");
-        u8g2Fonts.setCursor(10, 90);
-        u8g2Fonts.print(lastError);
-        printAt(10, 120, "Retrying in %lus...", backoffMs / 1000);
-        printAt(10, 140, "(attempt %d)", consecutiveFailures);
-
-    } while (display.nextPage());
+    u8g2Fonts.setFont(u8g2_font_8x13_mf);
+    printAt(10, 70, "Request failed:");
+    u8g2Fonts.setCursor(10, 90);
+    u8g2Fonts.print(message);
+    printAt(10, 120, "Retrying in %lus...", backoffMs / 1000);
+    printAt(10, 140, "(attempt %d)", consecutiveFailures);
 }
 
-void updateDisplay() {
-    bool fullRefresh = (updatesSinceFullRefresh >= FULL_REFRESH_INTERVAL);
+static void drawHeader() {
+    // Character width for 8x13 font
+    const int cw = 8;
 
-    if (fullRefresh) {
-        display.setFullWindow();
-        updatesSinceFullRefresh = 0;
-        Serial.println("Full refresh");
-    } else {
-        display.setPartialWindow(0, 0, display.width(), display.height());
-        updatesSinceFullRefresh++;
-        Serial.println("Partial refresh");
+    u8g2Fonts.setFont(u8g2_font_8x13_mf);
+    printAt(4, 16, "ADS-B Tracker");
+    if (pageCount() > 1) {
+        printAt(160, 16, "page %d/%d", currentPage + 1, pageCount());
     }
+    printAt(400 - 10 * cw, 16, "%d nearby", aircraftCount);
+
+    canvas.drawLine(0, 24, 400, 24, GxEPD_BLACK);
+}
 
+// Cards for one page (up to 5, 2 lines each), drawn between CARDS_TOP and CARDS_BOTTOM
+static void drawCards(int page) {
     // Character width for 8x13 font
     const int cw = 8;
 
-    display.firstPage();
-
-    do {
-        display.fillScreen(GxEPD_WHITE);
+    u8g2Fonts.setFont(u8g2_font_8x13_mf);
 
-        // === Header ===
-        u8g2Fonts.setFont(u8g2_font_8x13_mf);
-        printAt(4, 16, "ADS-B Tracker");
-        printAt(400 - 10 * cw, 16, "%d nearby", aircraftCount);
+    int first = page * CARDS_PER_PAGE;
+    int maxDisplay = min(aircraftCount - first, CARDS_PER_PAGE);
+    const int blockHeight = 48;
+    const int line1Base = 40;
 
-        display.drawLine(0, 24, 400, 24, GxEPD_BLACK);
+    for (int i = 0; i < maxDisplay; i++) {
+        const AircraftKey& key = aircraftOrder[first + i];
+        const Aircraft& a = aircraftList[key.index];
 
-        // === Aircraft cards (up to 5, 2 lines each) ===
-        int maxDisplay = min(aircraftCount, 5);
-        const int blockHeight = 48;
-        const int line1Base = 40;
+        char callsign[9], registration[11], type[5];
+        unpackString(a.callsign, callsign, 8);
+        unpackString(a.registration, registration, 10);
+        unpackString(a.type, type, 4);
+        int y1 = line1Base + i * blockHeight;
+        int y2 = y1 + 16;
 
-        for (int i = 0; i < maxDisplay; i++) {
-            Aircraft& a = aircraftList[i];
-            int y1 = line1Base + i * blockHeight;
-            int y2 = y1 + 16;
+        const int col2 = 80;   // distance / altitude column
+        const int col3 = 160;  // heading / speed column
+        const int col4 = 232;  // airline / type column
 
-            const int col2 = 80;   // distance / altitude column
-            const int col3 = 160;  // heading / speed column
-            const int col4 = 232;  // airline / type column
+        // --- Line 1: callsign | distance+bearing | hdg dir | airline route ---
+        printAt(4, y1, "%s", callsign[0] ? callsign : "-");
 
-            // --- Line 1: callsign | distance+bearing | hdg dir | airline ---
-            printAt(4, y1, "%s", a.callsign[0] ? a.callsign : "-");
+        // Approaching marker: small arrow pointing at the distance
+        if (aircraftCpa[key.index].time > 0) {
+            int16_t ay = y1 - 5;
+            canvas.fillTriangle(col2 - 3, ay, col2 - 8, ay - 4, col2 - 8, ay + 4, GxEPD_BLACK);
+        }
 
-            // Distance + bearing
-            char distBuf[12];
-            formatDistance(distBuf, sizeof(distBuf), a.distance);
-            printAt(col2, y1, "%s %s", distBuf, degreesToCardinal(a.bearing));
+        // Distance + bearing
+        char distBuf[12];
+        formatDistance(distBuf, sizeof(distBuf), key.distance / 100.0f);
+        printAt(col2, y1, "%s %s", distBuf, degreesToCardinal(angleToDegrees(a.bearing)));
 
-            // Heading
-            if (a.heading >= 0) {
-                printAt(col3, y1, "hdg %s", degreesToCardinal((float)a.heading));
-            }
+        // Heading
+        if (a.flags & AC_HEADING_VALID) {
+            printAt(col3, y1, "hdg %s", degreesToCardinal(angleToDegrees(a.heading)));
+        }
 
-            // Airline name
-            char airlineBuf[32];
-            buildAirlineName(airlineBuf, sizeof(airlineBuf), a.callsign);
-            printAt(col4, y1, "%s", airlineBuf);
-
-            // --- Line 2: registration | altitude+arrow | speed | type ---
-            printAt(4, y2, "%s", a.registration[0] ? a.registration : "-");
-
-            // Altitude with climb/descend indicator
-            if (a.altitude > 0) {
-                char altBuf[16];
-                snprintf(altBuf, sizeof(altBuf), "%dft", a.altitude);
-                printAt(col2, y2, "%s", altBuf);
-                // Draw triangle arrow after altitude text
-                int16_t ax = col2 + (int)strlen(altBuf) * cw + 4;
-                int16_t ay = y2 - 5;
-                if (a.verticalRate > 200) {
-                    display.fillTriangle(ax, ay - 4, ax - 3, ay + 2, ax + 3, ay + 2, GxEPD_BLACK);
-                } else if (a.verticalRate < -200) {
-                    display.fillTriangle(ax, ay + 4, ax - 3, ay - 2, ax + 3, ay - 2, GxEPD_BLACK);
-                }
-            } else {
-                printAt(col2, y2, "GND");
+        // Airline name, shortened to make room for the route if known
+        char airlineBuf[32];
+        char routeBuf[12];
+        if (lookupRoute(a.callsign, routeBuf, sizeof(routeBuf))) {
+            buildAirlineName(airlineBuf, sizeof(airlineBuf), callsign, 12);
+            printAt(400 - (int)strlen(routeBuf) * cw - 4, y1, "%s", routeBuf);
+        } else {
+            buildAirlineName(airlineBuf, sizeof(airlineBuf), callsign);
+        }
+        printAt(col4, y1, "%s", airlineBuf);
+
+        // --- Line 2: registration | altitude+arrow | speed | type ---
+        printAt(4, y2, "%s", registration[0] ? registration : "-");
+
+        // Altitude with climb/descend indicator
+        if (a.altitude > 0) {
+            char altBuf[16];
+            snprintf(altBuf, sizeof(altBuf), "%dft", a.altitude * ALT_UNIT_FT);
+            printAt(col2, y2, "%s", altBuf);
+            // Draw triangle arrow after altitude text
+            int16_t ax = col2 + (int)strlen(altBuf) * cw + 4;
+            int16_t ay = y2 - 5;
+            if (a.verticalRate > 200) {
+                canvas.fillTriangle(ax, ay - 4, ax - 3, ay + 2, ax + 3, ay + 2, GxEPD_BLACK);
+            } else if (a.verticalRate < -200) {
+                canvas.fillTriangle(ax, ay + 4, ax - 3, ay - 2, ax + 3, ay - 2, GxEPD_BLACK);
             }
+        } else {
+            printAt(col2, y2, "GND");
+        }
 
-            // Ground speed (* = estimated from IAS/TAS)
-            if (a.groundSpeed > 0) {
-                printAt(col3, y2, "%d kts%s", a.groundSpeed, a.speedEstimated ? "*" : "");
-            } else {
-                printAt(col3, y2, "- kts");
-            }
+        // Ground speed (* = estimated from IAS/TAS)
+        if (a.groundSpeed > 0) {
+            printAt(col3, y2, "%d kts%s", a.groundSpeed, (a.flags & AC_SPEED_ESTIMATED) ? "*" : "");
+        } else {
+            printAt(col3, y2, "- kts");
+        }
 
-            // Type name
-            char typeBuf[32];
-            buildTypeName(typeBuf, sizeof(typeBuf), a.type);
-            if (typeBuf[0]) {
-                printAt(col4, y2, "%s", typeBuf);
-            }
+        // Type name
+        char typeBuf[32];
+        buildTypeName(typeBuf, sizeof(typeBuf), type);
+        if (typeBuf[0]) {
+            printAt(col4, y2, "%s", typeBuf);
+        }
 
-            // Dotted separator between cards (not after last)
-            if (i < maxDisplay - 1) {
-                int sepY = y2 + 10;
-                for (int dx = 0; dx < 400; dx += 6) {
-                    display.drawPixel(dx, sepY, GxEPD_BLACK);
-                }
+        // Dotted separator between cards (not after last)
+        if (i < maxDisplay - 1) {
+            int sepY = y2 + 10;
+            for (int dx = 0; dx < 400; dx += 6) {
+                canvas.drawPixel(dx, sepY, GxEPD_BLACK);
             }
         }
+    }
 
-        // "No aircraft" message if empty
-        if (aircraftCount == 0) {
-            printAt(120, 150, "No aircraft nearby");
+    // "No aircraft" message if empty
+    if (aircraftCount == 0) {
+        printAt(120, 150, "No aircraft nearby");
+    }
+}
+
+static void drawFooter() {
+    // Character width for 8x13 font
+    const int cw = 8;
+
+    u8g2Fonts.setFont(u8g2_font_8x13_mf);
+    canvas.drawLine(0, 275, 400, 275, GxEPD_BLACK);
+    if (apiTimestamp > 0) {
+        static const char* months[] = {
+            "Jan","Feb","Mar","Apr","May","Jun",
+            "Jul","Aug","Sep","Oct","Nov","Dec"
+        };
+        time_t ts = apiTimestamp / 1000;
+        struct tm* timeinfo = localtime(&ts);
+        printAt(4, 293, "%s %d %02d:%02d",
+            months[timeinfo->tm_mon], timeinfo->tm_mday,
+            timeinfo->tm_hour, timeinfo->tm_min);
+    } else {
+        printAt(4, 293, "--- -- --:--");
+    }
+
+    // Weather on right side of footer (right-aligned)
+    if (weather.valid) {
+        int windKt = (int)round(weather.windSpeed * 1.94384f);
+        char wxBuf[48];
+        snprintf(wxBuf, sizeof(wxBuf), "%.0fC %s %s %dkt",
+            weather.temperature,
+            simplifySymbol(weather.symbol),
+            degreesToCardinal(weather.windDirection),
+            windKt);
+        int wxWidth = (int)strlen(wxBuf) * cw;
+        printAt(400 - wxWidth - 4, 293, "%s", wxBuf);
+    }
+}
+
+static uint32_t hashBytes(uint32_t h, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;  // FNV-1a
+    }
+    return h;
+}
+
+// Hash only what a card shows, at the resolution it is shown, so small
+// position changes that don't alter the text keep the cached page
+static uint32_t pageHash(int page) {
+    int first = page * CARDS_PER_PAGE;
+    int count = max(0, min(aircraftCount - first, CARDS_PER_PAGE));
+    uint32_t h = hashBytes(2166136261u, &count, sizeof(count));
+
+    for (int i = 0; i < count; i++) {
+        const AircraftKey& key = aircraftOrder[first + i];
+        const Aircraft& a = aircraftList[key.index];
+        int climb = a.verticalRate > 200 ? 1 : (a.verticalRate < -200 ? -1 : 0);
+        // Distance, bearing and heading exactly as drawCards() prints them
+        char distance[12];
+        formatDistance(distance, sizeof(distance), key.distance / 100.0f);
+        const char* bearing = degreesToCardinal(angleToDegrees(a.bearing));
+        const char* heading = (a.flags & AC_HEADING_VALID) ?
+            degreesToCardinal(angleToDegrees(a.heading)) : "";
+
+        h = hashBytes(h, &a.callsign, sizeof(a.callsign));
+        h = hashBytes(h, &a.registration, sizeof(a.registration));
+        h = hashBytes(h, &a.type, sizeof(a.type));
+        h = hashBytes(h, &a.altitude, sizeof(a.altitude));
+        h = hashBytes(h, &a.groundSpeed, sizeof(a.groundSpeed));
+        h = hashBytes(h, &climb, sizeof(climb));
+        h = hashBytes(h, distance, strlen(distance) + 1);
+        h = hashBytes(h, bearing, strlen(bearing) + 1);
+        h = hashBytes(h, heading, strlen(heading) + 1);
+        uint8_t estimated = a.flags & AC_SPEED_ESTIMATED;
+        h = hashBytes(h, &estimated, sizeof(estimated));
+        bool approaching = aircraftCpa[key.index].time > 0;
+        h = hashBytes(h, &approaching, sizeof(approaching));
+        char route[12] = "";
+        lookupRoute(a.callsign, route, sizeof(route));
+        h = hashBytes(h, route, strlen(route));
+    }
+    return h;
+}
+
+// Re-render the cached pages whose contents changed; uses the canvas as
+// scratch, which is safe because the display task sends shownFrame
+static void refreshPageCache() {
+    unsigned long start = micros();
+    int pages = min(pageCount(), PAGE_CACHE_PAGES);
+    int rendered = 0;
+
+    for (int p = 0; p < PAGE_CACHE_PAGES; p++) {
+        CachedPage& c = pageCache[p];
+        if (p >= pages) {
+            c.valid = false;  // page no longer exists
+            continue;
         }
 
-        // === Footer ===
-        display.drawLine(0, 275, 400, 275, GxEPD_BLACK);
-        if (apiTimestamp > 0) {
-            static const char* months[] = {
-                "Jan","Feb","Mar","Apr","May","Jun",
-                "Jul","Aug","Sep","Oct","Nov","Dec"
-            };
-            time_t ts = apiTimestamp / 1000;
-            struct tm* timeinfo = localtime(&ts);
-            printAt(4, 293, "%s %d %02d:%02d",
-                months[timeinfo->tm_mon], timeinfo->tm_mday,
-                timeinfo->tm_hour, timeinfo->tm_min);
-        } else {
-            printAt(4, 293, "--- -- --:--");
+        uint32_t h = pageHash(p);
+        if (c.valid && c.hash == h) continue;
+
+        canvas.fillRect(0, CARDS_TOP, SCREEN_W, CARDS_BOTTOM - CARDS_TOP, GxEPD_WHITE);
+        drawCards(p);
+        memcpy(c.rows, canvas.getBuffer() + CARDS_TOP * ROW_BYTES, CARDS_BYTES);
+        c.hash = h;
+        c.valid = true;
+        rendered++;
+    }
+
+    Serial.printf("Page cache: rendered %d of %d pages in %lu us, %u bytes\n",
+        rendered, pages, micros() - start, (unsigned)sizeof(pageCache));
+}
+
+// Build the frame for currentPage; returns true if the cards came from cache
+static bool composePage() {
+    canvas.fillScreen(GxEPD_WHITE);
+    drawHeader();
+    drawFooter();
+
+    if (currentPage < PAGE_CACHE_PAGES && pageCache[currentPage].valid) {
+        memcpy(canvas.getBuffer() + CARDS_TOP * ROW_BYTES, pageCache[currentPage].rows, CARDS_BYTES);
+        return true;
+    }
+    drawCards(currentPage);
+    return false;
+}
+
+static void logRefreshStats() {
+    Serial.printf("Refreshes: %d full, %d band cleans, %d partial (fixed-interval policy: %d full)\n",
+        fullRefreshes, regionCleans, partialRefreshes, legacyFullRefreshes);
+}
+
+// Old policy, simulated for the per-day comparison. It redrew only on new
+// data and errors, so page flips and the startup screen don't count.
+static void countLegacyRefresh(bool errorFrame) {
+    if (errorFrame || legacyUpdatesSinceFull >= LEGACY_FULL_REFRESH_INTERVAL) {
+        legacyFullRefreshes++;
+        legacyUpdatesSinceFull = errorFrame ? LEGACY_FULL_REFRESH_INTERVAL : 0;
+    } else {
+        legacyUpdatesSinceFull++;
+    }
+}
+
+// Charge the canvas against the ghosting budget, pick the refresh kind and
+// hand the frame to the display task; returns immediately
+static void startRefresh() {
+    const uint8_t* frame = canvas.getBuffer();
+
+    uint8_t overBudget = 0;
+    int overCount = 0;
+    for (int r = 0; r < GHOST_REGIONS; r++) {
+        const int begin = r * REGION_ROWS * ROW_BYTES;
+        const int end = begin + REGION_ROWS * ROW_BYTES;
+        uint32_t toggles = 0;
+        for (int i = begin; i < end; i++) {
+            toggles += __builtin_popcount(frame[i] ^ shownFrame[i]);
         }
+        regionToggles[r] += toggles;
+        if (regionToggles[r] >= REGION_BUDGET) {
+            overBudget |= 1 << r;
+            overCount++;
+        }
+    }
 
-        // Weather on right side of footer (right-aligned)
-        if (weather.valid) {
-            int windKt = (int)round(weather.windSpeed * 1.94384f);
-            char wxBuf[48];
-            snprintf(wxBuf, sizeof(wxBuf), "%.0fC %s %s %dkt",
-                weather.temperature,
-                simplifySymbol(weather.symbol),
-                degreesToCardinal(weather.windDirection),
-                windKt);
-            int wxWidth = (int)strlen(wxBuf) * cw;
-            printAt(400 - wxWidth - 4, 293, "%s", wxBuf);
+    bool full = panelUnknown || overCount >= GHOST_FULL_REFRESH_REGIONS;
+    if (full) {
+        memset(regionToggles, 0, sizeof(regionToggles));
+        overBudget = 0;
+        panelUnknown = false;
+        fullRefreshes++;
+        Serial.println("Full refresh");
+    } else {
+        for (int r = 0; r < GHOST_REGIONS; r++) {
+            if (overBudget & (1 << r)) regionToggles[r] = 0;
         }
+        regionCleans += overCount;
+        partialRefreshes++;
+        Serial.printf("Partial refresh, cleaning %d band(s)\n", overCount);
+    }
+
+    if (millis() - statsDayStart >= STATS_DAY_MS) {
+        logRefreshStats();
+        statsDayStart = millis();
+        fullRefreshes = regionCleans = partialRefreshes = legacyFullRefreshes = 0;
+    }
 
-    } while (display.nextPage());
+    memcpy(shownFrame, frame, sizeof(shownFrame));
+    refreshFull = full;
+    refreshCleanMask = overBudget;
+    refreshInFlight = true;
+    xTaskNotifyGive(displayTaskHandle);
+}
+
+bool isRefreshInFlight() {
+    return refreshInFlight;
+}
+
+static void showErrorFrame() {
+    drawErrorFrame(pendingError, pendingFailures, pendingBackoffMs);
+    errorShown = true;
+    startRefresh();
+}
+
+void updateDisplayError(const char* message, int consecutiveFailures, unsigned long backoffMs) {
+    strncpy(pendingError, message, sizeof(pendingError) - 1);
+    pendingError[sizeof(pendingError) - 1] = '\0';
+    pendingFailures = consecutiveFailures;
+    pendingBackoffMs = backoffMs;
+    countLegacyRefresh(true);
+
+    if (refreshInFlight) {
+        // Replace whatever was queued; drawn when the panel is ready
+        pendingFrame = FRAME_ERROR;
+        return;
+    }
+    showErrorFrame();
+}
+
+static void showAircraftFrame() {
+    if (framesHeld) {
+        pendingFrame = FRAME_AIRCRAFT;
+        return;
+    }
+    lockAircraftData();
+
+    // Pre-render straight away, even if the panel is still busy
+    if (currentPage >= pageCount()) currentPage = 0;
+    refreshPageCache();
+
+    if (refreshInFlight) {
+        pendingFrame = FRAME_AIRCRAFT;
+        Serial.println("Refresh in flight, frame queued");
+    } else {
+        composePage();
+        errorShown = false;
+        startRefresh();
+    }
+
+    unlockAircraftData();
+}
+
+void updateDisplay() {
+    countLegacyRefresh(false);
+    showAircraftFrame();
+}
+
+void showNextPage() {
+    if (framesHeld) return;
+    lockAircraftData();
+    int pages = pageCount();
+    if (pages <= 1 || errorShown || pendingFrame == FRAME_ERROR) {
+        unlockAircraftData();
+        return;
+    }
+
+    currentPage = (currentPage + 1) % pages;
+    if (refreshInFlight) {
+        pendingFrame = FRAME_AIRCRAFT;
+        unlockAircraftData();
+        return;
+    }
+
+    unsigned long start = micros();
+    bool cached = composePage();
+    unsigned long composeUs = micros() - start;
+    unlockAircraftData();
+
+    startRefresh();
+    Serial.printf("Page %d/%d composed in %lu us (%s)\n",
+        currentPage + 1, pages, composeUs, cached ? "cached" : "drawn");
+}
+
+void benchRender(unsigned long* renderUs, unsigned long* composeUs) {
+    lockAircraftData();
+    for (int p = 0; p < PAGE_CACHE_PAGES; p++) pageCache[p].valid = false;
+    currentPage = 0;
+
+    unsigned long start = micros();
+    refreshPageCache();
+    *renderUs = micros() - start;
+
+    start = micros();
+    composePage();
+    *composeUs = micros() - start;
+    unlockAircraftData();
+}
+
+void holdAircraftFrames(bool hold) {
+    framesHeld = hold;
+    if (hold) return;
+
+    // Pages were last rendered from the benchmark data
+    lockAircraftData();
+    for (int p = 0; p < PAGE_CACHE_PAGES; p++) pageCache[p].valid = false;
+    if (currentPage >= pageCount()) currentPage = 0;
+    refreshPageCache();
+    unlockAircraftData();
+    if (pendingFrame == FRAME_AIRCRAFT && !refreshInFlight) flushPendingFrame();
+}
+
+void flushPendingFrame() {
+    FrameKind frame = pendingFrame;
+    pendingFrame = FRAME_NONE;
+
+    if (frame == FRAME_AIRCRAFT) {
+        showAircraftFrame();
+    } else if (frame == FRAME_ERROR) {
+        showErrorFrame();
+    }
 }
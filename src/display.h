@@ -3,6 +3,9 @@
 
 #include <Arduino.h>
 
+// Runs on the loop task. Functions that draw aircraft or weather take the
+// aircraft data lock themselves (see api.h).
+
 // Initialize the display hardware
 void initDisplay();
 
@@ -10,10 +13,34 @@ void initDisplay();
 void showStartupScreen();
 
 // Update display with current aircraft data
+// Re-renders the cached pages whose contents changed, then shows the
+// current page. Returns once the frame is drawn; the panel refresh runs in the background
+// and EV_DISPLAY_READY is posted when it completes. If a refresh is already
+// in flight, the frame is queued (replacing any older queued frame).
 void updateDisplay();
 
+// Advance to the next page of aircraft cards (no-op with a single page or
+// while the error screen is up)
+void showNextPage();
+
+// Re-render every cached page and compose the current one without touching
+// the panel; for the benchmark. Times are in microseconds.
+void benchRender(unsigned long* renderUs, unsigned long* composeUs);
+
+// While held, aircraftList holds benchmark data: page flips are skipped and
+// aircraft frames are queued. Releasing (on the loop task) drops the cached
+// pages and draws any queued frame.
+void holdAircraftFrames(bool hold);
+
 // Show error screen
-// consecutiveFailures and backoffMs are used for retry info
-void updateDisplayError(int consecutiveFailures, unsigned long backoffMs);
+// message is copied; consecutiveFailures and backoffMs are used for retry info
+void updateDisplayError(const char* message, int consecutiveFailures, unsigned long backoffMs);
+
+// True while the panel is still refreshing the previous frame
+bool isRefreshInFlight();
+
+// Draw the frame queued during the last refresh, if any
+// Call on EV_DISPLAY_READY
+void flushPendingFrame();
 
 #endif
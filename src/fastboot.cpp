@@ -0,0 +1,190 @@
+#include "fastboot.h"
+#include "aircraft.h"
+#include "api.h"
+#include "config.h"
+#include "cpa.h"
+#include "serial.h"
+
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_attr.h>
+#include <esp_crc.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+// Reuse the last DHCP lease for the first association after boot
+// (0 = always run DHCP; the cached AP is still used)
+#ifndef FAST_BOOT_REUSE_LEASE
+#define FAST_BOOT_REUSE_LEASE 1
+#endif
+
+// Lifetime assumed for a DHCP lease; keep it at or below the router's
+#ifndef FAST_BOOT_LEASE_S
+#define FAST_BOOT_LEASE_S 3600
+#endif
+
+// Before this the system clock has not been set since power-on
+#define CLOCK_VALID_AFTER 1700000000
+
+// Nearest aircraft kept across resets: enough for the first few pages
+#define SNAPSHOT_AIRCRAFT 20
+#define SNAPSHOT_MAGIC 0x41445342  // "ADSB"
+
+struct Snapshot {
+    uint32_t magic;
+    uint32_t crc;                           // over everything after this field
+    unsigned long long apiTimestamp;
+    WeatherData weather;
+    int count;
+    Aircraft aircraft[SNAPSHOT_AIRCRAFT];   // nearest first
+    uint16_t distance[SNAPSHOT_AIRCRAFT];   // AircraftKey::distance
+    AircraftCpa cpa[SNAPSHOT_AIRCRAFT];
+};
+
+// Not cleared at boot; random after power-on, hence the CRC
+RTC_NOINIT_ATTR static Snapshot snapshot;
+
+struct NetworkCache {
+    uint8_t bssid[6];
+    uint8_t channel;                        // 0 = nothing cached
+    uint32_t ip;                            // 0 = no lease
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t leaseExpires;                  // Unix seconds; 0 = unknown
+};
+
+// This session is running on the cached lease as a static address
+static bool leaseReused = false;
+
+static uint32_t snapshotCrc() {
+    const size_t start = offsetof(Snapshot, apiTimestamp);
+    return esp_crc32_le(0, (const uint8_t*)&snapshot + start, sizeof(Snapshot) - start);
+}
+
+bool restoreSnapshot() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_POWERON || snapshot.magic != SNAPSHOT_MAGIC ||
+        snapshot.crc != snapshotCrc() ||
+        snapshot.count < 0 || snapshot.count > SNAPSHOT_AIRCRAFT) {
+        Serial.printf("No snapshot to restore (reset reason %d)\n", (int)reason);
+        return false;
+    }
+
+    for (int i = 0; i < snapshot.count; i++) {
+        aircraftList[i] = snapshot.aircraft[i];
+        aircraftCpa[i] = snapshot.cpa[i];
+        aircraftOrder[i].distance = snapshot.distance[i];
+        aircraftOrder[i].index = i;
+    }
+    aircraftCount = snapshot.count;
+    apiTimestamp = snapshot.apiTimestamp;
+    weather = snapshot.weather;
+
+    Serial.printf("Restored snapshot: %d aircraft (reset reason %d)\n",
+        aircraftCount, (int)reason);
+    return true;
+}
+
+void saveSnapshot() {
+    snapshot.magic = SNAPSHOT_MAGIC;
+    snapshot.count = min(aircraftCount, SNAPSHOT_AIRCRAFT);
+    for (int i = 0; i < snapshot.count; i++) {
+        snapshot.aircraft[i] = aircraftList[aircraftOrder[i].index];
+        snapshot.cpa[i] = aircraftCpa[aircraftOrder[i].index];
+        snapshot.distance[i] = aircraftOrder[i].distance;
+    }
+    snapshot.apiTimestamp = apiTimestamp;
+    snapshot.weather = weather;
+    snapshot.crc = snapshotCrc();
+}
+
+static bool loadNetwork(NetworkCache& net) {
+    Preferences prefs;
+    if (!prefs.begin("fastboot", true)) return false;
+    bool found = prefs.getBytes("network", &net, sizeof(net)) == sizeof(net);
+    prefs.end();
+    return found && net.channel != 0;
+}
+
+static void storeNetwork(const NetworkCache& net) {
+    Preferences prefs;
+    if (!prefs.begin("fastboot", false)) return;
+    prefs.putBytes("network", &net, sizeof(net));
+    prefs.end();
+}
+
+bool beginWiFi(bool useCache) {
+    NetworkCache net;
+    leaseReused = false;
+    if (useCache && loadNetwork(net)) {
+        // The system clock survives every reset but power-on
+        time_t now = time(nullptr);
+        bool lease = FAST_BOOT_REUSE_LEASE && net.ip != 0 &&
+                     now > CLOCK_VALID_AFTER && now < (time_t)net.leaseExpires;
+        if (lease) {
+            WiFi.config(IPAddress(net.ip), IPAddress(net.gateway),
+                        IPAddress(net.subnet), IPAddress(net.dns));
+            leaseReused = true;
+        } else {
+            WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        }
+        Serial.printf("WiFi: fast association to %02x:%02x:%02x:%02x:%02x:%02x on channel %d%s\n",
+            net.bssid[0], net.bssid[1], net.bssid[2], net.bssid[3], net.bssid[4], net.bssid[5],
+            net.channel, lease ? ", cached lease" : "");
+        WiFi.begin(WIFI_SSID, WIFI_PASSWORD, net.channel, net.bssid);
+        return true;
+    }
+
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);  // DHCP
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    return false;
+}
+
+void saveNetwork() {
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) return;
+
+    NetworkCache net;
+    memset(&net, 0, sizeof(net));  // padding is compared too
+    memcpy(net.bssid, bssid, sizeof(net.bssid));
+    net.channel = WiFi.channel();
+    net.ip = WiFi.localIP();
+    net.gateway = WiFi.gatewayIP();
+    net.subnet = WiFi.subnetMask();
+    net.dns = WiFi.dnsIP();
+
+    // The expiry is set by networkFetchDone() once the clock is known
+    NetworkCache stored;
+    memset(&stored, 0, sizeof(stored));
+    bool found = loadNetwork(stored);
+    if (found && stored.ip == net.ip) net.leaseExpires = stored.leaseExpires;
+    if (found && memcmp(&stored, &net, sizeof(net)) == 0) return;
+
+    storeNetwork(net);
+    Serial.println("WiFi: cached AP and lease updated");
+}
+
+void networkFetchDone(bool ok) {
+    if (leaseReused) {
+        // Hand the address back to DHCP, which renews the lease or replaces
+        // it; a failed fetch may mean the cached lease was no longer valid
+        leaseReused = false;
+        Serial.println("WiFi: leaving the cached lease, starting DHCP");
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        return;
+    }
+    if (!ok || apiTimestamp == 0) return;
+
+    // Keep the clock set, so the lease expiry can be checked after a reset
+    struct timeval tv = {(time_t)(apiTimestamp / 1000), 0};
+    settimeofday(&tv, nullptr);
+
+    // On a DHCP lease: push the stored expiry out, at most every half lease
+    NetworkCache net;
+    uint32_t now = tv.tv_sec;
+    if (!loadNetwork(net) || net.ip != (uint32_t)WiFi.localIP()) return;
+    if (net.leaseExpires > now + FAST_BOOT_LEASE_S / 2) return;
+    net.leaseExpires = now + FAST_BOOT_LEASE_S;
+    storeNetwork(net);
+}
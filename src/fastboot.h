@@ -0,0 +1,35 @@
+#ifndef FASTBOOT_H
+#define FASTBOOT_H
+
+#include <Arduino.h>
+
+// Warm-boot state, so a reset doesn't mean seconds of "Starting..."
+//
+// The nearest aircraft and the weather from the last good fetch are kept in
+// RTC memory, which survives software, watchdog and brownout resets (not
+// power-off). The AP's BSSID/channel and the DHCP lease are kept in NVS, so
+// the first association after boot can skip the scan and DHCP. The lease is
+// only reused before its expiry by the system clock, which is lost on
+// power-on, and only until the first fetch; then DHCP takes over.
+
+// Copy the last good snapshot back into aircraftList/weather
+// Returns false after power-on or if the snapshot is corrupt
+bool restoreSnapshot();
+
+// Save the nearest aircraft and the weather; call after each good fetch
+void saveSnapshot();
+
+// Start associating: straight to the cached AP with the cached lease if
+// useCache is set and one is stored (the lease only if unexpired), else a
+// normal scan and DHCP
+// Returns true if the cached AP was used
+bool beginWiFi(bool useCache);
+
+// Remember the current AP and lease; NVS is only written when they change
+void saveNetwork();
+
+// Call after each aircraft fetch. Leaves a reused lease for DHCP; after a
+// good fetch, sets the clock from the API and refreshes the lease expiry.
+void networkFetchDone(bool ok);
+
+#endif
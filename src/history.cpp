@@ -0,0 +1,563 @@
+#include "history.h"
+#include "aircraft.h"
+#include "api.h"
+#include "config.h"
+#include "serial.h"
+
+#include <LittleFS.h>
+#include <math.h>
+
+// Raw pages are kept this long before being folded into hourly summaries
+#ifndef HISTORY_RETENTION_HOURS
+#define HISTORY_RETENTION_HOURS 24
+#endif
+
+// Older hours are compacted early if the raw log grows past this size; if
+// the current hour alone reaches it, further pages are dropped
+#ifndef HISTORY_MAX_RAW_BYTES
+#define HISTORY_MAX_RAW_BYTES (768 * 1024)
+#endif
+
+// Fixes logged per cycle, in display order (nearest first by default)
+#ifndef HISTORY_MAX_FIXES
+#define HISTORY_MAX_FIXES 100
+#endif
+
+#define PAGE_SIZE 4096
+#define SLOT_SIZE 8
+#define PAGE_MAGIC 0x48534441  // "ADSH"
+#define MAX_PAGE_TRACKS 255    // a keyframe takes 2 of the 510 slots
+#define MAX_UNIQUE_PER_HOUR 512
+#define MAX_HOUR_FILES 64      // raw hours considered per compaction pass
+
+// Slot tag: top 2 bits are the slot type. A delta's track id is the low 6
+// bits plus DeltaSlot::trackHigh << 6. A keyframe's track is found by ICAO:
+// the page's track with that address, else the next new id.
+#define SLOT_CYCLE 0x40
+#define SLOT_KEY   0x80
+#define SLOT_DELTA 0xC0
+#define SLOT_TYPE_MASK 0xC0
+#define SLOT_TRACK_MASK 0x3F
+
+static const char* HOURS_DIR = "/h";  // raw pages, one file per hour
+static const char* HOURLY_PATH = "/hourly.bin";
+
+struct PageHeader {
+    uint32_t magic;
+    uint32_t baseTime;     // Unix seconds of the first cycle
+    uint16_t slotsUsed;
+    uint16_t trackCount;
+    uint32_t reserved;
+};
+
+struct CycleSlot {
+    uint8_t tag;
+    uint8_t count;         // fixes following in this page
+    uint16_t reserved;
+    uint32_t time;         // Unix seconds (API timestamp)
+};
+
+struct KeySlot {           // occupies two slots
+    uint8_t tag;
+    uint8_t icao[3];
+    int32_t lat;           // 1e-5 degrees
+    int32_t lon;
+    int16_t alt;           // 25 ft units
+    uint16_t gs;           // knots
+};
+
+struct DeltaSlot {
+    uint8_t tag;
+    int8_t dAlt;
+    int16_t dLat;
+    int16_t dLon;
+    int8_t dGs;
+    uint8_t trackHigh;     // track id bits 6-13
+};
+
+struct HourlySummary {
+    uint32_t hourStart;    // Unix seconds
+    uint16_t cycles;
+    uint16_t fixes;
+    uint16_t uniqueAircraft;
+    uint16_t peakAircraft; // most aircraft in a single cycle
+    int16_t minAlt;        // lowest airborne altitude, 25 ft units
+    uint16_t maxGs;
+};
+
+static_assert(sizeof(PageHeader) == 16, "PageHeader layout");
+static_assert(sizeof(CycleSlot) == SLOT_SIZE, "CycleSlot layout");
+static_assert(sizeof(KeySlot) == 2 * SLOT_SIZE, "KeySlot layout");
+static_assert(sizeof(DeltaSlot) == SLOT_SIZE, "DeltaSlot layout");
+static_assert(sizeof(HourlySummary) == 16, "HourlySummary layout");
+
+#define SLOTS_PER_PAGE ((PAGE_SIZE - sizeof(PageHeader)) / SLOT_SIZE)
+
+// Last fix per track, as a decoder would reconstruct it
+struct TrackState {
+    uint32_t icao;
+    int32_t lat;
+    int32_t lon;
+    int16_t alt;
+    uint16_t gs;
+};
+
+static bool mounted = false;
+static uint8_t page[PAGE_SIZE];     // page being filled
+static uint8_t scratch[PAGE_SIZE];  // compaction reads
+static TrackState tracks[MAX_PAGE_TRACKS];
+static TrackState decoded[MAX_PAGE_TRACKS];  // compaction, off the worker stack
+static uint32_t rawBytes = 0;       // total size of the hour files
+
+// Measurements
+static uint32_t fixesLogged = 0;
+static uint32_t encodedBytes = 0;   // slot bytes produced by the encoder
+static uint32_t flashBytes = 0;     // bytes written to the filesystem
+static uint32_t pagesDropped = 0;   // raw log at its size cap
+static unsigned long lastCycleUs = 0;
+static unsigned long maxCycleUs = 0;
+
+static PageHeader* pageHeader(uint8_t* p) {
+    return (PageHeader*)p;
+}
+
+static uint8_t* slotAt(uint8_t* p, int slot) {
+    return p + sizeof(PageHeader) + slot * SLOT_SIZE;
+}
+
+// "/h/<Unix hour>.bin"
+static void hourPath(char* buf, size_t len, uint32_t hour) {
+    snprintf(buf, len, "%s/%lu.bin", HOURS_DIR, (unsigned long)hour);
+}
+
+struct HourFile {
+    uint32_t hour;
+    uint32_t size;
+};
+
+// The oldest raw hour files, ascending; totalBytes covers all of them
+static int listHours(HourFile* files, int max, uint32_t& totalBytes) {
+    int count = 0;
+    totalBytes = 0;
+    File dir = LittleFS.open(HOURS_DIR);
+    if (!dir) return 0;
+
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        HourFile entry = {(uint32_t)strtoul(f.name(), nullptr, 10), (uint32_t)f.size()};
+        f.close();
+        totalBytes += entry.size;
+        if (entry.hour == 0) continue;
+
+        // Insertion sort, dropping the newest when full
+        int i = count < max ? count++ : max;
+        while (i > 0 && files[i - 1].hour > entry.hour) {
+            if (i < max) files[i] = files[i - 1];
+            i--;
+        }
+        if (i < max) files[i] = entry;
+    }
+    dir.close();
+    return count;
+}
+
+// Defined with compaction below
+static void foldHours(uint32_t currentHour);
+
+static void flushPage() {
+    PageHeader* h = pageHeader(page);
+    if (h->slotsUsed == 0) return;
+
+    // The size cap holds within the hour too: make room from older hours,
+    // else drop the page rather than fill the partition
+    uint32_t hour = h->baseTime / 3600;
+    if (rawBytes + PAGE_SIZE > HISTORY_MAX_RAW_BYTES) foldHours(hour);
+    if (rawBytes + PAGE_SIZE > HISTORY_MAX_RAW_BYTES) {
+        if (pagesDropped++ == 0) Serial.println("History: raw log at its size cap, dropping pages");
+        memset(page, 0, sizeof(page));
+        return;
+    }
+
+    char path[24];
+    hourPath(path, sizeof(path), hour);
+    File f = LittleFS.open(path, FILE_APPEND);
+    if (f) {
+        size_t written = f.write(page, PAGE_SIZE);
+        flashBytes += written;
+        rawBytes += written;
+        f.close();
+    } else {
+        Serial.println("History: cannot open log, page dropped");
+    }
+    memset(page, 0, sizeof(page));
+}
+
+static CycleSlot* beginCycle(uint32_t now) {
+    PageHeader* h = pageHeader(page);
+    if (h->slotsUsed == 0) {
+        h->magic = PAGE_MAGIC;
+        h->baseTime = now;
+    }
+    CycleSlot* c = (CycleSlot*)slotAt(page, h->slotsUsed++);
+    c->tag = SLOT_CYCLE;
+    c->time = now;
+    encodedBytes += SLOT_SIZE;
+    return c;
+}
+
+static int findTrack(uint32_t icao) {
+    PageHeader* h = pageHeader(page);
+    for (int i = 0; i < h->trackCount; i++) {
+        if (tracks[i].icao == icao) return i;
+    }
+    return -1;
+}
+
+void historyInit() {
+    if (!LittleFS.begin(true)) {
+        Serial.println("History: LittleFS mount failed");
+        return;
+    }
+    mounted = true;
+    memset(page, 0, sizeof(page));
+    if (!LittleFS.exists(HOURS_DIR)) LittleFS.mkdir(HOURS_DIR);
+    HourFile files[MAX_HOUR_FILES];
+    listHours(files, MAX_HOUR_FILES, rawBytes);
+    Serial.printf("History: %u of %u bytes used\n",
+        (unsigned)LittleFS.usedBytes(), (unsigned)LittleFS.totalBytes());
+}
+
+void historyLogCycle() {
+    if (!mounted || apiTimestamp == 0) return;
+
+    unsigned long start = micros();
+    uint32_t now = apiTimestamp / 1000;
+    PageHeader* h = pageHeader(page);
+
+    // Pages never span an hour, so each lands in its hour's file
+    if (h->slotsUsed > 0 && now / 3600 != h->baseTime / 3600) flushPage();
+
+    // Room for the cycle slot plus at least one keyframe
+    if (h->slotsUsed + 3 > SLOTS_PER_PAGE) flushPage();
+    CycleSlot* cycle = beginCycle(now);
+
+    int logged = 0;
+    for (int i = 0; i < aircraftCount && logged < HISTORY_MAX_FIXES; i++) {
+        Aircraft& a = aircraftList[aircraftOrder[i].index];
+        if (a.icao == 0 || (a.lat == 0 && a.lon == 0)) continue;
+        logged++;
+
+        int32_t lat = a.lat;
+        int32_t lon = a.lon;
+        int16_t alt = a.altitude;
+        uint16_t gs = a.groundSpeed;
+
+        int t = findTrack(a.icao);
+
+        // Page full or out of track ids: continue this cycle on a fresh page
+        if (h->slotsUsed + 2 > SLOTS_PER_PAGE ||
+            (t < 0 && h->trackCount >= MAX_PAGE_TRACKS)) {
+            flushPage();
+            cycle = beginCycle(now);
+            t = -1;
+        }
+
+        if (t >= 0) {
+            TrackState& s = tracks[t];
+            long dLat = lat - s.lat;
+            long dLon = lon - s.lon;
+            int dAlt = alt - s.alt;
+            int dGs = gs - s.gs;
+            bool fits = dLat >= INT16_MIN && dLat <= INT16_MAX &&
+                        dLon >= INT16_MIN && dLon <= INT16_MAX &&
+                        dAlt >= INT8_MIN && dAlt <= INT8_MAX &&
+                        dGs >= INT8_MIN && dGs <= INT8_MAX;
+            if (fits) {
+                DeltaSlot* d = (DeltaSlot*)slotAt(page, h->slotsUsed++);
+                d->tag = SLOT_DELTA | (t & SLOT_TRACK_MASK);
+                d->trackHigh = t >> 6;
+                d->dLat = dLat;
+                d->dLon = dLon;
+                d->dAlt = dAlt;
+                d->dGs = dGs;
+                s.lat = lat;
+                s.lon = lon;
+                s.alt = alt;
+                s.gs = gs;
+                encodedBytes += SLOT_SIZE;
+                cycle->count++;
+                fixesLogged++;
+                continue;
+            }
+            // Jump too large for a delta: re-key the same track id
+        } else {
+            t = h->trackCount++;
+        }
+
+        KeySlot* k = (KeySlot*)slotAt(page, h->slotsUsed);
+        h->slotsUsed += 2;
+        k->tag = SLOT_KEY | (t & SLOT_TRACK_MASK);
+        k->icao[0] = a.icao >> 16;
+        k->icao[1] = a.icao >> 8;
+        k->icao[2] = a.icao;
+        k->lat = lat;
+        k->lon = lon;
+        k->alt = alt;
+        k->gs = gs;
+        tracks[t] = {a.icao, lat, lon, alt, gs};
+        encodedBytes += 2 * SLOT_SIZE;
+        cycle->count++;
+        fixesLogged++;
+    }
+
+    lastCycleUs = micros() - start;
+    if (lastCycleUs > maxCycleUs) maxCycleUs = lastCycleUs;
+    Serial.printf("History: %d fixes, page %u/%u slots, %lu us\n",
+        cycle->count, h->slotsUsed, (unsigned)SLOTS_PER_PAGE, lastCycleUs);
+}
+
+// --- Compaction ---
+
+static uint32_t seenIcao[MAX_UNIQUE_PER_HOUR];
+static int seenCount = 0;
+
+static void noteAircraft(HourlySummary& sum, uint32_t icao) {
+    for (int i = 0; i < seenCount; i++) {
+        if (seenIcao[i] == icao) return;
+    }
+    if (seenCount < MAX_UNIQUE_PER_HOUR) seenIcao[seenCount++] = icao;
+    sum.uniqueAircraft++;
+}
+
+static void noteFix(HourlySummary& sum, const TrackState& s) {
+    sum.fixes++;
+    if (s.alt > 0 && s.alt < sum.minAlt) sum.minAlt = s.alt;
+    if (s.gs > sum.maxGs) sum.maxGs = s.gs;
+}
+
+static void startSummary(HourlySummary& sum, uint32_t hour) {
+    sum = {hour * 3600, 0, 0, 0, 0, INT16_MAX, 0};
+    seenCount = 0;
+}
+
+// Fold one page into the running summary for its hour.
+// cycleTime/cycleFixes carry a cycle that continues across pages.
+static void summarizePage(uint8_t* p, HourlySummary& sum,
+                          uint32_t& cycleTime, uint16_t& cycleFixes) {
+    int slots = pageHeader(p)->slotsUsed;
+    int trackCount = 0;
+
+    for (int i = 0; i < slots;) {
+        uint8_t tag = *slotAt(p, i);
+
+        switch (tag & SLOT_TYPE_MASK) {
+            case SLOT_CYCLE: {
+                CycleSlot* c = (CycleSlot*)slotAt(p, i);
+                if (c->time != cycleTime) {
+                    sum.cycles++;
+                    cycleTime = c->time;
+                    cycleFixes = 0;
+                }
+                cycleFixes += c->count;
+                if (cycleFixes > sum.peakAircraft) sum.peakAircraft = cycleFixes;
+                i += 1;
+                break;
+            }
+            case SLOT_KEY: {
+                KeySlot* k = (KeySlot*)slotAt(p, i);
+                uint32_t icao = ((uint32_t)k->icao[0] << 16) | (k->icao[1] << 8) | k->icao[2];
+                int t = 0;
+                while (t < trackCount && decoded[t].icao != icao) t++;
+                if (t == trackCount) {
+                    if (trackCount == MAX_PAGE_TRACKS) {
+                        Serial.println("History: corrupt slot, skipping rest of page");
+                        return;
+                    }
+                    trackCount++;
+                }
+                TrackState& s = decoded[t];
+                s.icao = icao;
+                s.lat = k->lat;
+                s.lon = k->lon;
+                s.alt = k->alt;
+                s.gs = k->gs;
+                noteAircraft(sum, s.icao);
+                noteFix(sum, s);
+                i += 2;
+                break;
+            }
+            case SLOT_DELTA: {
+                DeltaSlot* d = (DeltaSlot*)slotAt(p, i);
+                int t = (tag & SLOT_TRACK_MASK) | (d->trackHigh << 6);
+                if (t >= trackCount) {
+                    Serial.println("History: corrupt slot, skipping rest of page");
+                    return;
+                }
+                TrackState& s = decoded[t];
+                s.lat += d->dLat;
+                s.lon += d->dLon;
+                s.alt += d->dAlt;
+                s.gs += d->dGs;
+                noteFix(sum, s);
+                i += 1;
+                break;
+            }
+            default:
+                Serial.println("History: corrupt slot, skipping rest of page");
+                return;
+        }
+    }
+}
+
+static void appendSummary(HourlySummary& sum) {
+    File f = LittleFS.open(HOURLY_PATH, FILE_APPEND);
+    if (!f) return;
+    flashBytes += f.write((const uint8_t*)&sum, sizeof(sum));
+    f.close();
+}
+
+// Hour of the newest summary, 0 if none
+static uint32_t lastSummaryHour() {
+    File f = LittleFS.open(HOURLY_PATH, FILE_READ);
+    if (!f) return 0;
+    HourlySummary sum;
+    uint32_t hour = 0;
+    if (f.size() >= sizeof(sum) && f.seek(f.size() - sizeof(sum)) &&
+        f.read((uint8_t*)&sum, sizeof(sum)) == sizeof(sum)) {
+        hour = sum.hourStart / 3600;
+    }
+    f.close();
+    return hour;
+}
+
+static void summarizeHour(uint32_t hour, HourlySummary& sum) {
+    char path[24];
+    hourPath(path, sizeof(path), hour);
+    startSummary(sum, hour);
+
+    File f = LittleFS.open(path, FILE_READ);
+    if (!f) return;
+    uint32_t cycleTime = 0;
+    uint16_t cycleFixes = 0;
+    while (f.read(scratch, PAGE_SIZE) == PAGE_SIZE) {
+        if (pageHeader(scratch)->magic != PAGE_MAGIC) break;
+        summarizePage(scratch, sum, cycleTime, cycleFixes);
+    }
+    f.close();
+}
+
+static void foldHours(uint32_t currentHour) {
+    unsigned long start = millis();
+    uint32_t cutoffHour = currentHour - HISTORY_RETENTION_HOURS;
+    PageHeader* h = pageHeader(page);
+    uint32_t pendingHour = h->slotsUsed ? h->baseTime / 3600 : 0;
+
+    HourFile files[MAX_HOUR_FILES];
+    int count = listHours(files, MAX_HOUR_FILES, rawBytes);
+    uint32_t summarized = lastSummaryHour();
+
+    // Fold hours past retention, plus the oldest hours while the raw log has
+    // no room for another page. Never the current hour or one with a page in
+    // RAM.
+    // Each file is written once and deleted whole: nothing is copied.
+    int folded = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t hour = files[i].hour;
+        if (hour >= currentHour || hour == pendingHour) break;
+        if (hour >= cutoffHour && rawBytes + PAGE_SIZE <= HISTORY_MAX_RAW_BYTES) break;
+
+        // Already summarized if a reset hit between the append and the remove
+        if (hour > summarized) {
+            HourlySummary sum;
+            summarizeHour(hour, sum);
+            appendSummary(sum);
+            summarized = hour;
+        }
+
+        char path[24];
+        hourPath(path, sizeof(path), hour);
+        LittleFS.remove(path);
+        rawBytes -= files[i].size;
+        folded++;
+    }
+
+    if (folded > 0) {
+        Serial.printf("History: folded %d hour files into hourly summaries in %lu ms\n",
+            folded, millis() - start);
+    }
+}
+
+void historyCompact() {
+    if (!mounted || apiTimestamp == 0) return;
+    foldHours(apiTimestamp / 1000 / 3600);
+}
+
+// --- Serial commands ---
+
+// Hex dump framed by BEGIN/END lines for host-side capture
+static void streamFile(const char* path) {
+    File f = LittleFS.open(path, FILE_READ);
+    if (!f) {
+        Serial.printf("HIST MISSING %s\n", path);
+        return;
+    }
+    Serial.printf("HIST BEGIN %s %u\n", path, (unsigned)f.size());
+    uint8_t buf[32];
+    char line[2 * sizeof(buf) + 1];
+    int n;
+    while ((n = f.read(buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < n; i++) {
+            snprintf(line + 2 * i, 3, "%02x", buf[i]);
+        }
+        Serial.println(line);
+    }
+    f.close();
+    Serial.println("HIST END");
+}
+
+static void printStats() {
+    HourFile files[MAX_HOUR_FILES];
+    int count = listHours(files, MAX_HOUR_FILES, rawBytes);
+    File hourly = LittleFS.open(HOURLY_PATH, FILE_READ);
+    Serial.printf("raw log: %u bytes in %d hour files, hourly: %u bytes, pending page: %u slots, "
+                  "%lu pages dropped at the size cap\n",
+        (unsigned)rawBytes, count, hourly ? (unsigned)hourly.size() : 0,
+        pageHeader(page)->slotsUsed, (unsigned long)pagesDropped);
+    if (hourly) hourly.close();
+
+    Serial.printf("fixes: %lu, encoded: %lu bytes (%.1f bytes/fix, 16 without deltas)\n",
+        (unsigned long)fixesLogged, (unsigned long)encodedBytes,
+        fixesLogged ? (float)encodedBytes / fixesLogged : 0.0f);
+    Serial.printf("flash writes: %lu bytes, write amplification %.2f\n",
+        (unsigned long)flashBytes,
+        encodedBytes ? (float)flashBytes / encodedBytes : 0.0f);
+    Serial.printf("per-cycle cost: last %lu us, max %lu us\n", lastCycleUs, maxCycleUs);
+}
+
+bool historyCommand(const char* line) {
+    if (strncmp(line, "hist", 4) != 0) return false;
+    if (!mounted) {
+        Serial.println("History: filesystem not mounted");
+        return true;
+    }
+
+    const char* arg = line + 4;
+    while (*arg == ' ') arg++;
+
+    if (strcmp(arg, "raw") == 0) {
+        flushPage();  // include the partial page
+        HourFile files[MAX_HOUR_FILES];
+        int count = listHours(files, MAX_HOUR_FILES, rawBytes);
+        for (int i = 0; i < count; i++) {
+            char path[24];
+            hourPath(path, sizeof(path), files[i].hour);
+            streamFile(path);
+        }
+    } else if (strcmp(arg, "hourly") == 0) {
+        streamFile(HOURLY_PATH);
+    } else if (strcmp(arg, "stats") == 0) {
+        printStats();
+    } else {
+        Serial.println("usage: hist raw | hist hourly | hist stats");
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <Arduino.h>
+
+// Traffic history log in LittleFS
+//
+// Raw fixes go to one file per UTC hour, /h/<Unix hour>.bin, as a sequence
+// of fixed 4 KB pages written whole so flash is only touched once per page.
+// Each page holds fixed 8-byte slots:
+//   cycle: one per fetch, carries the API timestamp and aircraft count
+//   key:   two slots, full fix (ICAO, lat/lon 1e-5 deg, alt 25 ft, gs kt)
+//   delta: one slot, change since the previous fix of the same track
+// A page never spans an hour boundary and restarts keyframes, so pages can
+// be decoded independently. Each cycle logs at most HISTORY_MAX_FIXES
+// aircraft, nearest first, and a page tracks up to 255 of them. Hour files older than the retention window are
+// folded into 16-byte hourly summaries in /hourly.bin and then deleted whole.
+
+// Mount the filesystem; call once from setup()
+void historyInit();
+
+// Append the current aircraftList as one cycle
+void historyLogCycle();
+
+// Fold old hour files into hourly summaries; call periodically
+void historyCompact();
+
+// Serial commands: "hist raw", "hist hourly", "hist stats"
+// Returns false if the line is not a history command
+bool historyCommand(const char* line);
+
+#endif
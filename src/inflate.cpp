@@ -0,0 +1,220 @@
+#include "inflate.h"
+#include "serial.h"
+
+#include <esp_crc.h>
+#include <rom/miniz.h>
+
+// gzip header flags (RFC 1952)
+#define GZIP_FHCRC    0x02
+#define GZIP_FEXTRA   0x04
+#define GZIP_FNAME    0x08
+#define GZIP_FCOMMENT 0x10
+
+BodyStream::BodyStream(Stream& source, bool gzip) : source(source), gzip(gzip) {
+    startMs = millis();
+    heapBefore = ESP.getFreeHeap();
+    heapLow = heapBefore;
+
+    if (gzip) {
+        decomp = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+        window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+        if (decomp) tinfl_init(decomp);
+    }
+}
+
+BodyStream::~BodyStream() {
+    free(decomp);
+    free(window);
+}
+
+void BodyStream::sampleHeap() {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < heapLow) heapLow = freeHeap;
+}
+
+bool BodyStream::fillInput() {
+    if (sourceEnded) return false;
+    sampleHeap();
+    inPos = 0;
+    // Take only what has arrived, so the last short chunk doesn't wait out
+    // the stream timeout; block for one byte when nothing is buffered
+    size_t want = min((size_t)max(source.available(), 1), sizeof(input));
+    inLen = source.readBytes((char*)input, want);
+    wireBytes += inLen;
+    if (inLen == 0) sourceEnded = true;
+    return inLen > 0;
+}
+
+int BodyStream::inputByte() {
+    if (inPos >= inLen && !fillInput()) return -1;
+    return input[inPos++];
+}
+
+bool BodyStream::parseGzipHeader() {
+    uint8_t header[10];
+    for (int i = 0; i < 10; i++) {
+        int c = inputByte();
+        if (c < 0) return false;
+        header[i] = c;
+    }
+    // Magic 1f 8b, method 8 (deflate)
+    if (header[0] != 0x1f || header[1] != 0x8b || header[2] != 8) return false;
+
+    uint8_t flags = header[3];
+    if (flags & GZIP_FEXTRA) {
+        int lo = inputByte();
+        int hi = inputByte();
+        if (lo < 0 || hi < 0) return false;
+        for (int n = lo | (hi << 8); n > 0; n--) {
+            if (inputByte() < 0) return false;
+        }
+    }
+    for (uint8_t field : {GZIP_FNAME, GZIP_FCOMMENT}) {
+        if (!(flags & field)) continue;
+        int c;
+        while ((c = inputByte()) > 0) {}
+        if (c < 0) return false;
+    }
+    if (flags & GZIP_FHCRC) {
+        if (inputByte() < 0 || inputByte() < 0) return false;
+    }
+    return true;
+}
+
+// Run the inflater until it produces output, finishes or fails
+bool BodyStream::inflateMore() {
+    if (done || failed || !ok()) return false;
+
+    if (!headerParsed) {
+        if (!parseGzipHeader()) {
+            Serial.println("gzip: bad header");
+            failed = true;
+            return false;
+        }
+        headerParsed = true;
+    }
+
+    while (true) {
+        if (inPos >= inLen) fillInput();
+
+        size_t inSize = inLen - inPos;
+        size_t outSize = TINFL_LZ_DICT_SIZE - windowNext;
+        uint32_t flags = sourceEnded ? 0 : TINFL_FLAG_HAS_MORE_INPUT;
+
+        unsigned long start = micros();
+        tinfl_status status = tinfl_decompress(decomp, input + inPos, &inSize,
+            window, window + windowNext, &outSize, flags);
+        if (outSize > 0) bodyCrc = esp_crc32_le(bodyCrc, window + windowNext, outSize);
+        inflateUs += micros() - start;
+        inPos += inSize;
+
+        if (outSize > 0) {
+            outPos = windowNext;
+            outEnd = windowNext + outSize;
+            windowNext = outEnd & (TINFL_LZ_DICT_SIZE - 1);
+            bodyBytes += outSize;
+            if (status == TINFL_STATUS_DONE) done = true;
+            return true;
+        }
+        if (status == TINFL_STATUS_DONE) {
+            done = true;
+            return false;
+        }
+        if (status < 0 || (status == TINFL_STATUS_NEEDS_MORE_INPUT && sourceEnded)) {
+            Serial.printf("gzip: inflate failed (%d)\n", (int)status);
+            failed = true;
+            return false;
+        }
+    }
+}
+
+// gzip trailer: CRC-32 and length (mod 2^32) of the inflated data
+bool BodyStream::checkTrailer() {
+    uint8_t trailer[8];
+    size_t n = 0;
+    // tinfl may have pulled the first trailer bytes into its bit buffer
+    // without giving them back; the partial byte sits below them
+    uint32_t bits = decomp->m_num_bits;
+    for (; n < bits / 8 && n < sizeof(trailer); n++) {
+        trailer[n] = decomp->m_bit_buf >> ((bits & 7) + 8 * n);
+    }
+    for (; n < sizeof(trailer); n++) {
+        int c = inputByte();
+        if (c < 0) return false;
+        trailer[n] = c;
+    }
+    uint32_t crc = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (uint32_t)trailer[3] << 24;
+    uint32_t size = trailer[4] | trailer[5] << 8 | trailer[6] << 16 | (uint32_t)trailer[7] << 24;
+    return crc == bodyCrc && size == (uint32_t)bodyBytes;
+}
+
+bool BodyStream::finish() {
+    if (!gzip || trailerChecked) return valid();
+
+    // Inflate whatever the parser left unread, e.g. a trailing newline
+    while (inflateMore()) {}
+    if (!failed && done) {
+        if (!checkTrailer()) {
+            Serial.println("gzip: bad trailer");
+            failed = true;
+        }
+    } else {
+        failed = true;
+    }
+    trailerChecked = true;
+    return valid();
+}
+
+int BodyStream::available() {
+    if (!gzip) return source.available();
+    if (outPos < outEnd) return outEnd - outPos;
+    return (done || failed) ? 0 : 1;
+}
+
+int BodyStream::read() {
+    if (!gzip) {
+        int c = source.read();
+        if (c >= 0) {
+            wireBytes++;
+            bodyBytes++;
+            if (bodyBytes % sizeof(input) == 0) sampleHeap();
+        }
+        return c;
+    }
+    if (outPos >= outEnd && !inflateMore()) return -1;
+    return window[outPos++];
+}
+
+int BodyStream::peek() {
+    if (!gzip) return source.peek();
+    if (outPos >= outEnd && !inflateMore()) return -1;
+    return window[outPos];
+}
+
+size_t BodyStream::readBytes(char* buffer, size_t length) {
+    if (!gzip) {
+        size_t n = source.readBytes(buffer, length);
+        wireBytes += n;
+        bodyBytes += n;
+        if ((bodyBytes - n) / sizeof(input) != bodyBytes / sizeof(input)) sampleHeap();
+        return n;
+    }
+
+    size_t copied = 0;
+    while (copied < length) {
+        if (outPos >= outEnd && !inflateMore()) break;
+        size_t n = min(length - copied, outEnd - outPos);
+        memcpy(buffer + copied, window + outPos, n);
+        outPos += n;
+        copied += n;
+    }
+    return copied;
+}
+
+void BodyStream::printStats(const char* label) {
+    sampleHeap();
+    Serial.printf("%s: %s %u -> %u bytes, %lu ms, inflate %lu us, peak heap %u bytes\n",
+        label, gzip ? "gzip" : "identity",
+        (unsigned)wireBytes, (unsigned)bodyBytes, millis() - startMs,
+        inflateUs, (unsigned)(heapBefore - heapLow));
+}
@@ -0,0 +1,82 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <Arduino.h>
+
+struct tinfl_decompressor_tag;
+
+// HTTP response body as a Stream, for deserializeJson().
+// Passes bytes through unchanged, or inflates a gzip body on the fly
+// through a 32 KB window, so the decompressed body is never held in full.
+// Counts wire/body bytes, inflate CPU time and peak heap use for logging.
+class BodyStream : public Stream {
+public:
+    BodyStream(Stream& source, bool gzip);
+    ~BodyStream();
+
+    // False if the inflate buffers could not be allocated
+    bool ok() const { return !gzip || (decomp && window); }
+
+    // False if the gzip stream was malformed
+    bool valid() const { return !failed; }
+
+    // Read a gzip body to its end and check the CRC-32/length trailer.
+    // Call once the parser is done; returns valid()
+    bool finish();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+
+    // Bytes taken from the source (compressed for gzip) and after inflating
+    size_t wireSize() const { return wireBytes; }
+    size_t bodySize() const { return bodyBytes; }
+
+    // CPU time spent inside the inflater
+    unsigned long inflateTime() const { return inflateUs; }
+
+    // Largest drop in free heap seen while reading, in bytes
+    uint32_t peakHeap() const { return heapBefore - heapLow; }
+
+    // One-line summary: "<label>: gzip 4213 -> 30544 bytes, ..."
+    void printStats(const char* label);
+
+private:
+    bool fillInput();
+    int inputByte();
+    bool parseGzipHeader();
+    bool inflateMore();
+    bool checkTrailer();
+    void sampleHeap();
+
+    Stream& source;
+    bool gzip;
+    bool headerParsed = false;
+    bool sourceEnded = false;
+    bool done = false;
+    bool failed = false;
+    bool trailerChecked = false;
+
+    tinfl_decompressor_tag* decomp = nullptr;
+    uint8_t* window = nullptr;     // circular LZ dictionary, also the output buffer
+    size_t windowNext = 0;         // where the next inflate call writes
+    size_t outPos = 0;             // unread output: window[outPos, outEnd)
+    size_t outEnd = 0;
+    uint32_t bodyCrc = 0;          // CRC-32 of everything inflated so far
+
+    uint8_t input[512];
+    size_t inPos = 0;
+    size_t inLen = 0;
+
+    // Measurements
+    unsigned long startMs;
+    unsigned long inflateUs = 0;
+    size_t wireBytes = 0;
+    size_t bodyBytes = 0;
+    uint32_t heapBefore;
+    uint32_t heapLow;
+};
+
+#endif
@@ -10,12 +10,36 @@ HWCDC USBSerial;
 #include "config.h"
 #include "aircraft.h"
 #include "api.h"
+#include "bench.h"
 #include "display.h"
+#include "fastboot.h"
+#include "history.h"
+#include "routes.h"
+#include "scheduler.h"
 
 // Timing state
-static unsigned long lastUpdate = 0;
-static unsigned long lastWeatherUpdate = 0;
 static int consecutiveFailures = 0;
+static int wifiAttempts = 0;
+static unsigned long renderRequestedAt = 0;
+static bool wifiConnectedOnce = false;
+
+// Boot timing: the first frame on the panel (snapshot or startup screen),
+// then the first one drawn from freshly fetched aircraft
+static bool firstFrameReported = false;
+static bool freshRequested = false;
+static bool freshSubmitted = false;
+static bool freshFrameReported = false;
+
+// Background aircraft fetch; the result is read on EV_FETCH_DONE
+static bool aircraftFetchRunning = false;
+static bool aircraftFetchOk = false;
+static char aircraftFetchError[48];
+
+// Serial command line being received; the worker owns it (and the port)
+// while commandRunning is set
+static char commandLine[64];
+static int commandLength = 0;
+static bool commandRunning = false;
 
 // Backoff configuration
 #define BACKOFF_BASE_MS 5000
@@ -24,86 +48,280 @@ static int consecutiveFailures = 0;
 // Weather update interval (10 minutes)
 #define WEATHER_UPDATE_INTERVAL_MS 600000
 
+// History compaction interval (1 hour)
+#define HISTORY_COMPACT_INTERVAL_MS 3600000
+
+// Auto-cycle pages of aircraft this often (0 = only on button press)
+#ifndef PAGE_FLIP_INTERVAL_MS
+#define PAGE_FLIP_INTERVAL_MS 10000
+#endif
+
+// WiFi reconnect: wait this long for an association before retrying,
+// and reboot after this many consecutive failed attempts
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 10000
+#endif
+#ifndef WIFI_MAX_RECONNECT_ATTEMPTS
+#define WIFI_MAX_RECONNECT_ATTEMPTS 12
+#endif
+
+// Timeout for the targeted association to the cached AP; on failure the
+// next attempt falls back to a full scan and DHCP
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000
+
 static unsigned long getBackoffMs() {
     if (consecutiveFailures == 0) return UPDATE_INTERVAL_MS;
     unsigned long backoff = BACKOFF_BASE_MS * (1 << (consecutiveFailures - 1));
     return min(backoff, (unsigned long)BACKOFF_MAX_MS);
 }
 
-static void connectWiFi() {
-    Serial.print("Connecting to WiFi");
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+// Runs on the WiFi event task; only forwards to the scheduler
+static void onWiFiEvent(WiFiEvent_t event) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            postEvent(EV_WIFI_UP);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            postEvent(EV_WIFI_DOWN);
+            break;
+        default:
+            break;
+    }
+}
 
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
+#ifdef PAGE_BUTTON_PIN
+static void IRAM_ATTR onPageButton() {
+    static unsigned long lastPress = 0;
+    unsigned long now = millis();
+    if (now - lastPress < 200) return;  // debounce
+    lastPress = now;
+    postEventFromISR(EV_PAGE_FLIP);
+}
+#endif
+
+// Runs on the USB CDC event task; only forwards to the scheduler
+static void onSerialRx(void*, esp_event_base_t, int32_t, void*) {
+    postEvent(EV_SERIAL_COMMAND);
+}
+
+// --- Background work, run on the worker task ---
+
+static void fetchAircraftWork() {
+    aircraftFetchOk = fetchAircraftData();
+    if (aircraftFetchOk) {
+        historyLogCycle();
+        fetchRoutes();
+        saveSnapshot();
+    } else {
+        strncpy(aircraftFetchError, lastError.c_str(), sizeof(aircraftFetchError) - 1);
+        aircraftFetchError[sizeof(aircraftFetchError) - 1] = '\0';
     }
+}
 
-    Serial.println(" connected!");
-    Serial.print("IP: ");
-    Serial.println(WiFi.localIP());
+static void fetchWeatherWork() {
+    fetchWeatherData();
 }
 
-void setup() {
-    Serial.begin(115200);
-    delay(1000);
-    Serial.println("\nADS-B Display Starting...");
+static void runCommandWork() {
+    if (!historyCommand(commandLine) && !benchCommand(commandLine) &&
+        !orderCommand(commandLine)) {
+        Serial.printf("Unknown command: %s\n", commandLine);
+    }
+}
 
-    // Initialize display
-    initDisplay();
-    showStartupScreen();
+// --- Event handlers, run on the loop task ---
 
-    // Connect to WiFi
-    connectWiFi();
+static void startWiFi() {
+    wifiAttempts++;
+    if (wifiAttempts > WIFI_MAX_RECONNECT_ATTEMPTS) {
+        Serial.println("WiFi: giving up, restarting");
+        ESP.restart();
+    }
+    Serial.printf("Connecting to WiFi (attempt %d/%d)\n",
+        wifiAttempts, WIFI_MAX_RECONNECT_ATTEMPTS);
+    WiFi.disconnect();
+    // First attempt after boot goes straight to the AP used before the reset
+    bool fast = beginWiFi(wifiAttempts == 1 && !wifiConnectedOnce);
+    scheduleIn(EV_WIFI_RECONNECT, fast ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS);
+}
 
-    // Set timezone
-    setenv("TZ", TIMEZONE, 1);
-    tzset();
+static void handleWiFiUp() {
+    Serial.printf("WiFi connected, IP: %s (%lu ms after boot)\n",
+        WiFi.localIP().toString().c_str(), millis());
+    wifiAttempts = 0;
+    wifiConnectedOnce = true;
+    cancelEvent(EV_WIFI_RECONNECT);
+    saveNetwork();
 
-    // Initial weather fetch
-    fetchWeatherData();
-    lastWeatherUpdate = millis();
+    // Catch up on fetches that were deferred while offline; after boot the
+    // weather waits for the first aircraft frame (see handleRender)
+    if (!isScheduled(EV_FETCH_WEATHER) && freshRequested) scheduleIn(EV_FETCH_WEATHER, 0);
+    if (!isScheduled(EV_FETCH_AIRCRAFT) && !aircraftFetchRunning) scheduleIn(EV_FETCH_AIRCRAFT, 0);
+}
+
+static void handleWiFiDown() {
+    if (isScheduled(EV_WIFI_RECONNECT)) return;  // attempt already in progress
+    Serial.println("WiFi lost, reconnecting...");
+    scheduleIn(EV_WIFI_RECONNECT, 0);
+}
+
+static void handleWiFiReconnect() {
+    if (WiFi.status() == WL_CONNECTED) return;
+    startWiFi();
+}
 
-    // Initial aircraft fetch and display
-    if (fetchAircraftData()) {
+static void handleFetchAircraft() {
+    // Deferred while offline; handleWiFiUp() re-arms it. While a fetch is
+    // running, handleFetchDone() re-arms it.
+    if (WiFi.status() != WL_CONNECTED || aircraftFetchRunning) return;
+    aircraftFetchRunning = true;
+    runInBackground(fetchAircraftWork, EV_FETCH_DONE);
+}
+
+static void handleFetchDone() {
+    aircraftFetchRunning = false;
+    networkFetchDone(aircraftFetchOk);
+    if (aircraftFetchOk) {
         consecutiveFailures = 0;
-        lastUpdate = millis();
-        updateDisplay();
+        renderRequestedAt = millis();
+        postEvent(EV_RENDER);
     } else {
         consecutiveFailures++;
-        lastUpdate = millis();
-        updateDisplayError(consecutiveFailures, getBackoffMs());
+        updateDisplayError(aircraftFetchError, consecutiveFailures, getBackoffMs());
+        Serial.printf("Backing off for %lu ms\n", getBackoffMs());
     }
+    scheduleIn(EV_FETCH_AIRCRAFT, getBackoffMs());
 }
 
-void loop() {
-    unsigned long interval = getBackoffMs();
-
-    // Check if it's time to update aircraft data
-    if (millis() - lastUpdate >= interval) {
-        if (fetchAircraftData()) {
-            consecutiveFailures = 0;
-            lastUpdate = millis();
-            updateDisplay();
-        } else {
-            consecutiveFailures++;
-            lastUpdate = millis();
-            updateDisplayError(consecutiveFailures, getBackoffMs());
-            Serial.printf("Backing off for %lu ms\n", getBackoffMs());
-        }
+static void handleFetchWeather() {
+    // No address while DHCP takes over from a cached lease; handleWiFiUp()
+    // arms it again
+    if (WiFi.status() != WL_CONNECTED || WiFi.localIP() == INADDR_NONE) return;
+    runInBackground(fetchWeatherWork, EV_COUNT);
+    scheduleIn(EV_FETCH_WEATHER, WEATHER_UPDATE_INTERVAL_MS);
+}
+
+static void handleRender() {
+    if (!freshRequested) {
+        freshRequested = true;
+        freshSubmitted = !isRefreshInFlight();  // else queued behind the boot frame
     }
+    updateDisplay();
+
+    // First weather fetch only once the first aircraft frame is with the
+    // panel, so it never competes with it; later ones run on their interval
+    if (!isScheduled(EV_FETCH_WEATHER)) scheduleIn(EV_FETCH_WEATHER, 0);
+}
 
-    // Update weather periodically (less frequent than aircraft)
-    if (millis() - lastWeatherUpdate >= WEATHER_UPDATE_INTERVAL_MS) {
-        fetchWeatherData();
-        lastWeatherUpdate = millis();
+static void handlePageFlip() {
+    renderRequestedAt = millis();
+    showNextPage();
+    if (PAGE_FLIP_INTERVAL_MS > 0) scheduleIn(EV_PAGE_FLIP, PAGE_FLIP_INTERVAL_MS);
+}
+
+static void handleDisplayReady() {
+    unsigned long now = millis();
+    Serial.printf("Frame on panel %lu ms after request\n", now - renderRequestedAt);
+    if (!firstFrameReported) {
+        firstFrameReported = true;
+        Serial.printf("Boot to first frame: %lu ms\n", now);
+    } else if (freshSubmitted && !freshFrameReported) {
+        freshFrameReported = true;
+        Serial.printf("Boot to fresh frame: %lu ms\n", now);
     }
 
-    // Reconnect WiFi if needed
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi lost, reconnecting...");
-        connectWiFi();
+    flushPendingFrame();
+    if (freshRequested && isRefreshInFlight()) freshSubmitted = true;
+}
+
+static void handleHistoryCompact() {
+    runInBackground(historyCompact, EV_COUNT);
+    scheduleIn(EV_HISTORY_COMPACT, HISTORY_COMPACT_INTERVAL_MS);
+}
+
+static void handleSerialCommand() {
+    // Bytes after the command line (a bench payload) belong to the command
+    if (commandRunning) return;
+
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r') continue;
+        if (c != '\n') {
+            if (commandLength < (int)sizeof(commandLine) - 1) commandLine[commandLength++] = c;
+            continue;
+        }
+        commandLine[commandLength] = '\0';
+        commandLength = 0;
+        if (!commandLine[0]) continue;
+
+        commandRunning = true;
+        runInBackground(runCommandWork, EV_COMMAND_DONE);
+        return;
+    }
+}
+
+static void handleCommandDone() {
+    commandRunning = false;
+    if (Serial.available()) postEvent(EV_SERIAL_COMMAND);
+}
+
+static void handleBenchDone() {
+    benchReport();
+}
+
+void setup() {
+    Serial.begin(115200);
+    // After a watchdog/brownout/crash reset, redraw the last frame straight
+    // away; only a power-on waits for the USB host to open the port
+    bool warmBoot = restoreSnapshot();
+    if (!warmBoot) delay(1000);
+    Serial.println("\nADS-B Display Starting...");
+
+    schedulerInit();
+    onEvent(EV_WIFI_UP, handleWiFiUp);
+    onEvent(EV_WIFI_DOWN, handleWiFiDown);
+    onEvent(EV_WIFI_RECONNECT, handleWiFiReconnect);
+    onEvent(EV_FETCH_AIRCRAFT, handleFetchAircraft);
+    onEvent(EV_FETCH_WEATHER, handleFetchWeather);
+    onEvent(EV_RENDER, handleRender);
+    onEvent(EV_DISPLAY_READY, handleDisplayReady);
+    onEvent(EV_PAGE_FLIP, handlePageFlip);
+    onEvent(EV_HISTORY_COMPACT, handleHistoryCompact);
+    onEvent(EV_SERIAL_COMMAND, handleSerialCommand);
+    onEvent(EV_FETCH_DONE, handleFetchDone);
+    onEvent(EV_COMMAND_DONE, handleCommandDone);
+    onEvent(EV_BENCH_DONE, handleBenchDone);
+    Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, onSerialRx);
+
+    // Set timezone (the restored frame shows its fetch time)
+    setenv("TZ", TIMEZONE, 1);
+    tzset();
+
+    // Initialize display
+    initDisplay();
+    if (warmBoot) {
+        updateDisplay();
+    } else {
+        showStartupScreen();
     }
 
-    delay(1000);
+    // Connect to WiFi while the rest starts; the first fetches are kicked
+    // off by EV_WIFI_UP
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+    WiFi.onEvent(onWiFiEvent);
+    startWiFi();
+
+    historyInit();
+
+    if (PAGE_FLIP_INTERVAL_MS > 0) scheduleIn(EV_PAGE_FLIP, PAGE_FLIP_INTERVAL_MS);
+#ifdef PAGE_BUTTON_PIN
+    pinMode(PAGE_BUTTON_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(PAGE_BUTTON_PIN), onPageButton, FALLING);
+#endif
+    scheduleIn(EV_HISTORY_COMPACT, HISTORY_COMPACT_INTERVAL_MS);
+}
+
+void loop() {
+    runScheduler();
 }
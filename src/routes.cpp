@@ -0,0 +1,222 @@
+#include "routes.h"
+#include "aircraft.h"
+#include "config.h"
+#include "serial.h"
+
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Route endpoint; point at a local stand-in (tools/route_server.py) to test
+#ifndef ROUTE_API_URL
+#define ROUTE_API_URL "https://api.adsb.lol/api/0/routeset"
+#endif
+
+// Cached routes (24 bytes each) and how long a route is trusted. One slot
+// per tracked aircraft, so a full cycle never evicts its own entries.
+#ifndef ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE MAX_AIRCRAFT
+#endif
+#ifndef ROUTE_CACHE_TTL_MS
+#define ROUTE_CACHE_TTL_MS 3600000UL  // 1 hour
+#endif
+
+// Most callsigns sent in one request
+#define ROUTE_BATCH_MAX 100
+
+struct RouteEntry {
+    uint64_t callsign;         // packString(); 0 = empty slot
+    uint32_t origin;           // IATA code, packString(); 0 = route unknown
+    uint32_t destination;
+    unsigned long fetchedAt;   // millis()
+    unsigned long lastUsed;    // millis(), for LRU eviction
+};
+
+static RouteEntry cache[ROUTE_CACHE_SIZE];
+
+// fetchRoutes() runs on the worker task, lookupRoute() on the loop task
+static SemaphoreHandle_t cacheLock = xSemaphoreCreateMutex();
+
+// Totals since boot
+static uint32_t totalLookups = 0;
+static uint32_t totalHits = 0;
+static uint32_t totalRequests = 0;
+
+static RouteEntry* findEntry(uint64_t callsign) {
+    for (int i = 0; i < ROUTE_CACHE_SIZE; i++) {
+        if (cache[i].callsign == callsign) return &cache[i];
+    }
+    return nullptr;
+}
+
+// Existing entry for the callsign, else an empty slot, else the least
+// recently used one. Entries used this cycle (lastUsed == now) are never
+// evicted; returns nullptr if every slot is one of them.
+static RouteEntry* claimEntry(uint64_t callsign, unsigned long now) {
+    RouteEntry* empty = nullptr;
+    RouteEntry* oldest = &cache[0];
+    for (int i = 0; i < ROUTE_CACHE_SIZE; i++) {
+        RouteEntry& e = cache[i];
+        if (e.callsign == callsign) return &e;
+        if (e.callsign == 0 && !empty) empty = &e;
+        if (now - e.lastUsed > now - oldest->lastUsed) oldest = &e;
+    }
+    RouteEntry* e = empty ? empty : oldest;
+    if (!empty && oldest->lastUsed == now) return nullptr;
+    e->callsign = callsign;
+    return e;
+}
+
+// "LHR-JFK" or multi-leg "LHR-DXB-SYD": first and last airport
+static void parseRoute(const char* codes, RouteEntry& e) {
+    if (strlen(codes) < 7 || codes[3] != '-') return;
+    const char* last = strrchr(codes, '-');
+    if (strlen(last + 1) != 3) return;
+    e.origin = packString(codes, 3);
+    e.destination = packString(last + 1, 3);
+}
+
+static bool requestRoutes(const int* indices, int count, unsigned long now) {
+    JsonDocument request;
+    JsonArray planes = request["planes"].to<JsonArray>();
+    for (int i = 0; i < count; i++) {
+        const Aircraft& a = aircraftList[indices[i]];
+        char callsign[9];
+        unpackString(a.callsign, callsign, 8);
+        JsonObject plane = planes.add<JsonObject>();
+        plane["callsign"] = callsign;
+        plane["lat"] = a.lat / 1e5f;
+        plane["lng"] = a.lon / 1e5f;
+    }
+    String body;
+    serializeJson(request, body);
+
+    HTTPClient http;
+    http.begin(ROUTE_API_URL);
+    http.useHTTP10(true);
+    http.addHeader("Content-Type", "application/json");
+    http.addHeader("User-Agent", "ESP32-ADSB-Display/1.0 (github.com/mcm69/adsb-display)");
+
+    int httpCode = http.POST(body);
+    totalRequests++;
+    if (httpCode != 200) {
+        Serial.printf("Route HTTP error: %d\n", httpCode);
+        http.end();
+        return false;
+    }
+
+    JsonDocument filter;
+    filter[0]["callsign"] = true;
+    filter[0]["_airport_codes_iata"] = true;
+    filter[0]["plausible"] = true;
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, http.getStream(),
+        DeserializationOption::Filter(filter));
+    http.end();
+
+    if (error) {
+        Serial.print("Route JSON parse error: ");
+        Serial.println(error.c_str());
+        return false;
+    }
+
+    // Every requested callsign gets an entry, so unknown routes are not
+    // asked for again until the TTL expires
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    int uncached = 0;
+    for (int i = 0; i < count; i++) {
+        RouteEntry* e = claimEntry(aircraftList[indices[i]].callsign, now);
+        if (!e) {
+            uncached++;
+            continue;
+        }
+        e->origin = 0;
+        e->destination = 0;
+        e->fetchedAt = now;
+        e->lastUsed = now;
+    }
+
+    for (JsonObject route : doc.as<JsonArray>()) {
+        char callsign[9];
+        strncpy(callsign, route["callsign"] | "", sizeof(callsign) - 1);
+        callsign[sizeof(callsign) - 1] = '\0';
+        for (int i = strlen(callsign) - 1; i >= 0 && callsign[i] == ' '; i--) {
+            callsign[i] = '\0';
+        }
+        uint64_t packed = packString(callsign, 8);
+        RouteEntry* e = packed ? findEntry(packed) : nullptr;
+        if (!e) continue;
+        // Skip routes the server flags as implausible for this position
+        JsonVariant plausible = route["plausible"];
+        if (plausible.isNull() || plausible.as<bool>()) {
+            parseRoute(route["_airport_codes_iata"] | "", *e);
+        }
+    }
+    xSemaphoreGive(cacheLock);
+
+    if (uncached > 0) {
+        Serial.printf("Routes: cache oversubscribed, %d routes not cached (ROUTE_CACHE_SIZE %d)\n",
+            uncached, ROUTE_CACHE_SIZE);
+    }
+    return true;
+}
+
+void fetchRoutes() {
+    unsigned long start = millis();
+    int missing[ROUTE_BATCH_MAX];
+    int missingCount = 0;
+    int lookups = 0;
+    int hits = 0;
+
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    for (int i = 0; i < aircraftCount; i++) {
+        const Aircraft& a = aircraftList[i];
+        if (a.callsign == 0) continue;
+        lookups++;
+
+        RouteEntry* e = findEntry(a.callsign);
+        if (e && start - e->fetchedAt < ROUTE_CACHE_TTL_MS) {
+            e->lastUsed = start;
+            hits++;
+            continue;
+        }
+
+        bool queued = false;
+        for (int j = 0; j < missingCount && !queued; j++) {
+            queued = aircraftList[missing[j]].callsign == a.callsign;
+        }
+        if (!queued && missingCount < ROUTE_BATCH_MAX) missing[missingCount++] = i;
+    }
+    xSemaphoreGive(cacheLock);
+
+    totalLookups += lookups;
+    totalHits += hits;
+
+    if (missingCount > 0 && WiFi.status() == WL_CONNECTED) {
+        requestRoutes(missing, missingCount, start);
+    }
+
+    Serial.printf("Routes: %d/%d cached, %d requested, +%lu ms (hit rate %.0f%%, %lu requests total)\n",
+        hits, lookups, missingCount, millis() - start,
+        totalLookups ? 100.0f * totalHits / totalLookups : 0.0f,
+        (unsigned long)totalRequests);
+}
+
+bool lookupRoute(uint64_t callsign, char* buf, size_t len) {
+    if (callsign == 0) return false;
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+    RouteEntry* e = findEntry(callsign);
+    uint32_t originCode = e ? e->origin : 0;
+    uint32_t destinationCode = e ? e->destination : 0;
+    xSemaphoreGive(cacheLock);
+    if (originCode == 0) return false;
+
+    char origin[4], destination[4];
+    unpackString(originCode, origin, 3);
+    unpackString(destinationCode, destination, 3);
+    snprintf(buf, len, "%s-%s", origin, destination);
+    return true;
+}
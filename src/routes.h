@@ -0,0 +1,17 @@
+#ifndef ROUTES_H
+#define ROUTES_H
+
+#include <Arduino.h>
+
+// Look up origin/destination for the current aircraftList.
+// Callsigns missing from the route cache (or past their TTL) are sent to the
+// routeset API in one batched POST; steady-state cycles make no requests.
+// Logs the cycle's cache hit rate and the time added.
+// Blocks on HTTP: call from the worker task.
+void fetchRoutes();
+
+// Cached route for a packed callsign, formatted "LHR-JFK"
+// Returns false if the route is unknown or not cached
+bool lookupRoute(uint64_t callsign, char* buf, size_t len);
+
+#endif
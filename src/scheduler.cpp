@@ -0,0 +1,136 @@
+#include "scheduler.h"
+#include "serial.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+// Longest single sleep; bounds how stale millis() wraparound handling can get
+#define MAX_SLEEP_MS 60000
+
+// Worker task for blocking work (HTTPS, JSON parsing, LittleFS)
+#define WORKER_QUEUE_LENGTH 8
+#define WORKER_STACK_BYTES 12288
+
+static const char* eventNames[EV_COUNT] = {
+    "wifi-up", "wifi-down", "wifi-reconnect",
+    "fetch-aircraft", "fetch-weather", "render", "display-ready", "page-flip",
+    "history-compact", "serial-command", "fetch-done", "command-done",
+    "bench-done"
+};
+
+struct WorkItem {
+    EventHandler work;
+    EventId done;
+};
+
+struct TimerSlot {
+    bool armed;
+    unsigned long deadline;
+};
+
+static TaskHandle_t schedulerTask = nullptr;
+static EventHandler handlers[EV_COUNT];
+static TimerSlot timers[EV_COUNT];
+
+// Worst lateness seen per event since boot (ms)
+static unsigned long maxLateMs[EV_COUNT];
+
+static QueueHandle_t workQueue = nullptr;
+
+static void workerTask(void*) {
+    WorkItem item;
+    while (true) {
+        xQueueReceive(workQueue, &item, portMAX_DELAY);
+        item.work();
+        if (item.done != EV_COUNT) postEvent(item.done);
+    }
+}
+
+void schedulerInit() {
+    schedulerTask = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < EV_COUNT; i++) {
+        handlers[i] = nullptr;
+        timers[i].armed = false;
+        maxLateMs[i] = 0;
+    }
+
+    workQueue = xQueueCreate(WORKER_QUEUE_LENGTH, sizeof(WorkItem));
+    xTaskCreate(workerTask, "worker", WORKER_STACK_BYTES, nullptr, 1, nullptr);
+}
+
+void onEvent(EventId id, EventHandler handler) {
+    handlers[id] = handler;
+}
+
+void scheduleIn(EventId id, unsigned long delayMs) {
+    timers[id].deadline = millis() + delayMs;
+    timers[id].armed = true;
+}
+
+void cancelEvent(EventId id) {
+    timers[id].armed = false;
+}
+
+bool isScheduled(EventId id) {
+    return timers[id].armed;
+}
+
+void postEvent(EventId id) {
+    xTaskNotify(schedulerTask, 1UL << id, eSetBits);
+}
+
+void postEventFromISR(EventId id) {
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(schedulerTask, 1UL << id, eSetBits, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+void runInBackground(EventHandler work, EventId done) {
+    WorkItem item = {work, done};
+    if (xQueueSend(workQueue, &item, 0) != pdTRUE) {
+        Serial.println("[sched] worker queue full, work dropped");
+    }
+}
+
+static void dispatch(EventId id) {
+    if (handlers[id]) handlers[id]();
+}
+
+void runScheduler() {
+    // Find the nearest deadline
+    unsigned long now = millis();
+    unsigned long sleepMs = MAX_SLEEP_MS;
+    for (int i = 0; i < EV_COUNT; i++) {
+        if (!timers[i].armed) continue;
+        long remaining = (long)(timers[i].deadline - now);
+        if (remaining <= 0) {
+            sleepMs = 0;
+            break;
+        }
+        if ((unsigned long)remaining < sleepMs) sleepMs = remaining;
+    }
+
+    // Block until a deadline passes or another task posts an event
+    uint32_t posted = 0;
+    xTaskNotifyWait(0, ULONG_MAX, &posted, pdMS_TO_TICKS(sleepMs));
+
+    for (int i = 0; i < EV_COUNT; i++) {
+        if (posted & (1UL << i)) dispatch((EventId)i);
+    }
+
+    now = millis();
+    for (int i = 0; i < EV_COUNT; i++) {
+        if (!timers[i].armed) continue;
+        long late = (long)(now - timers[i].deadline);
+        if (late < 0) continue;
+
+        timers[i].armed = false;
+        if ((unsigned long)late > maxLateMs[i]) maxLateMs[i] = late;
+        Serial.printf("[sched] %s late %ld ms (max %lu ms)\n",
+            eventNames[i], late, maxLateMs[i]);
+
+        dispatch((EventId)i);
+        now = millis();
+    }
+}
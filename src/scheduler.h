@@ -0,0 +1,57 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+// Events driving the main loop. Each event has one timer slot (a pending
+// deadline) and can also be posted directly from other tasks or ISRs.
+// Handlers must not block: network and flash work goes to the worker task
+// through runInBackground(), which posts an event when it is done.
+enum EventId {
+    EV_WIFI_UP,          // station got an IP address
+    EV_WIFI_DOWN,        // station lost its connection
+    EV_WIFI_RECONNECT,   // reconnect attempt / association timeout
+    EV_FETCH_AIRCRAFT,   // aircraft poll deadline
+    EV_FETCH_WEATHER,    // weather poll deadline
+    EV_RENDER,           // new data is ready to be drawn
+    EV_DISPLAY_READY,    // panel finished refreshing
+    EV_PAGE_FLIP,        // show the next page of aircraft
+    EV_HISTORY_COMPACT,  // fold old history pages into hourly summaries
+    EV_SERIAL_COMMAND,   // bytes arrived on the USB serial port
+    EV_FETCH_DONE,       // background aircraft fetch finished
+    EV_COMMAND_DONE,     // background serial command finished
+    EV_BENCH_DONE,       // bench payload parsed, ready to time the render
+    EV_COUNT
+};
+
+typedef void (*EventHandler)();
+
+// Must be called from the task that will run runScheduler() (the loop task)
+void schedulerInit();
+
+// Register the handler dispatched when an event fires
+void onEvent(EventId id, EventHandler handler);
+
+// Arm the event's timer, replacing any earlier deadline
+void scheduleIn(EventId id, unsigned long delayMs);
+
+// Disarm the event's timer
+void cancelEvent(EventId id);
+
+bool isScheduled(EventId id);
+
+// Fire an event as soon as possible; safe from any task
+void postEvent(EventId id);
+
+// Same as postEvent, for use inside interrupt handlers
+void postEventFromISR(EventId id);
+
+// Run work on the worker task, then post done (EV_COUNT = post nothing).
+// Work items run one at a time, in the order they were queued.
+void runInBackground(EventHandler work, EventId done);
+
+// Sleep until the next deadline or posted event, then dispatch everything due.
+// Never busy-waits: the task blocks on its notification value.
+void runScheduler();
+
+#endif
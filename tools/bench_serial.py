@@ -0,0 +1,42 @@
+"""Serial side of the device "bench" commands, shared by the bench tools.
+
+A command line may be followed by a payload of the length it announces.
+The device answers with one result line of space-separated key=value
+fields, with "error=" last. Needs pyserial for the port itself.
+"""
+
+import time
+
+CHUNK = 256
+
+
+def send(port, command, payload=b""):
+    port.reset_input_buffer()
+    port.write(f"{command}\n".encode())
+    # Small chunks so the device-side USB buffer never overflows
+    for i in range(0, len(payload), CHUNK):
+        port.write(payload[i:i + CHUNK])
+    port.flush()
+
+
+def wait_for(port, prefix, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        line = port.readline().decode(errors="replace").strip()
+        if line.startswith(prefix):
+            return line
+    raise TimeoutError(f"no {prefix.strip()} line from the device")
+
+
+def parse_result(line, prefix):
+    # error= is last and may contain spaces
+    head, _, error = line[len(prefix):].partition(" error=")
+    result = dict(item.split("=", 1) for item in head.split())
+    result["error"] = error
+    return result
+
+
+def run(port, command, payload, prefix, timeout):
+    """Send a command and its payload, return the parsed result line."""
+    send(port, command, payload)
+    return parse_result(wait_for(port, prefix, timeout), prefix)
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Compressed vs uncompressed response bodies, measured on the device.
+
+"record" saves one adsb.lol and one met.no response for a location. Each is
+kept twice with the same content: as the gzip body the server sent and as
+the identity body inflated from it. If the server answers uncompressed,
+the gzip copy is made locally instead.
+
+"run" sends every recorded body to the serial "bench body" command. The
+firmware reads it through BodyStream and the real parser, and reports CPU
+time (time waiting on the serial link excluded), inflate time and peak
+heap. Air time is estimated here from the byte count, since the device
+can't see it: one 802.11 frame per TCP segment at --phy-mbps plus a fixed
+per-frame cost for preamble, SIFS, ACK and backoff. TLS record overhead is
+ignored.
+
+Needs pyserial for "run".
+
+Usage: python3 tools/body_bench.py record --lat 59.4 --lon 24.8 [--dir bodies]
+       python3 tools/body_bench.py run --port /dev/ttyACM0 [--dir bodies]
+       [--repeat 3] [--phy-mbps 72.2] [--csv body_bench.csv]
+"""
+
+import argparse
+import csv
+import gzip
+import math
+import os
+import sys
+import urllib.request
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import bench_serial  # noqa: E402
+
+USER_AGENT = "ESP32-ADSB-Display/1.0 (github.com/mcm69/adsb-display)"
+SOURCES = {
+    "aircraft": "https://api.adsb.lol/v2/point/{lat:.6f}/{lon:.6f}/{radius}",
+    "weather": "https://api.met.no/weatherapi/locationforecast/2.0/compact?lat={lat:.4f}&lon={lon:.4f}",
+}
+ENCODINGS = {"gzip": ".json.gz", "identity": ".json"}
+
+# Air time model
+MSS = 1460              # TCP payload per segment
+FRAME_OVERHEAD = 84     # TCP/IP 40, LLC/SNAP 8, 802.11 header and FCS 36, bytes
+FRAME_FIXED_US = 150    # preamble, SIFS, block ACK, average DIFS and backoff
+
+FIELDS = ["kind", "encoding", "run", "file_bytes", "wire", "body", "air_us",
+          "cpu_us", "inflate_us", "heap_peak", "error"]
+
+
+def record(args):
+    os.makedirs(args.dir, exist_ok=True)
+    for kind, url in SOURCES.items():
+        url = url.format(lat=args.lat, lon=args.lon, radius=args.radius)
+        request = urllib.request.Request(url, headers={
+            "User-Agent": USER_AGENT,
+            "Accept": "application/json",
+            "Accept-Encoding": "gzip",
+        })
+        with urllib.request.urlopen(request, timeout=30) as response:
+            raw = response.read()
+            encoding = response.headers.get("Content-Encoding", "identity").lower()
+
+        if encoding == "gzip":
+            compressed, identity = raw, gzip.decompress(raw)
+        else:
+            print(f"{kind}: server sent {encoding}, compressing locally")
+            compressed, identity = gzip.compress(raw), raw
+
+        for name, body in (("gzip", compressed), ("identity", identity)):
+            path = os.path.join(args.dir, kind + ENCODINGS[name])
+            with open(path, "wb") as f:
+                f.write(body)
+            print(f"{path}: {len(body)} bytes")
+
+
+def air_time_us(size, phy_mbps):
+    frames = max(1, math.ceil(size / MSS))
+    bits = (size + frames * FRAME_OVERHEAD) * 8
+    return round(frames * FRAME_FIXED_US + bits / phy_mbps)
+
+
+def run_one(port, kind, encoding, body, timeout):
+    return bench_serial.run(port, f"bench body {kind} {encoding} {len(body)}", body,
+                            "BODY ", timeout)
+
+
+def run(args):
+    import serial
+
+    rows = []
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        for kind in SOURCES:
+            for encoding, suffix in ENCODINGS.items():
+                path = os.path.join(args.dir, kind + suffix)
+                if not os.path.exists(path):
+                    print(f"{path} missing, run 'record' first")
+                    continue
+                with open(path, "rb") as f:
+                    body = f.read()
+                for n in range(args.repeat):
+                    result = run_one(port, kind, encoding, body, args.timeout)
+                    result.update(run=n, file_bytes=len(body),
+                                  air_us=air_time_us(len(body), args.phy_mbps))
+                    rows.append(result)
+
+    print(f"{'body':<20} {'bytes':>8} {'inflated':>9} {'air ms':>7} {'cpu ms':>7} "
+          f"{'inflate ms':>10} {'peak heap':>9}  error")
+    for r in rows:
+        print(f"{r['kind'] + ' ' + r['encoding']:<20} {r['file_bytes']:>8} {r['body']:>9} "
+              f"{r['air_us'] / 1000:>7.1f} {int(r['cpu_us']) / 1000:>7.1f} "
+              f"{int(r['inflate_us']) / 1000:>10.1f} {r['heap_peak']:>9}  {r['error']}")
+
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"Results written to {args.csv}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    rec = commands.add_parser("record", help="save gzip and identity bodies from the live APIs")
+    rec.add_argument("--lat", type=float, required=True)
+    rec.add_argument("--lon", type=float, required=True)
+    rec.add_argument("--radius", type=int, default=25, help="adsb.lol radius in NM")
+    rec.add_argument("--dir", default="bodies")
+
+    bench = commands.add_parser("run", help="send the recorded bodies to the device")
+    bench.add_argument("--port", required=True, help="device serial port")
+    bench.add_argument("--baud", type=int, default=115200)
+    bench.add_argument("--dir", default="bodies")
+    bench.add_argument("--repeat", type=int, default=3, help="runs per body")
+    bench.add_argument("--phy-mbps", type=float, default=72.2,
+                       help="PHY rate for the air time estimate (72.2 = HT20 MCS7 short GI)")
+    bench.add_argument("--timeout", type=float, default=60, help="seconds to wait per run")
+    bench.add_argument("--csv", default="body_bench.csv")
+
+    args = parser.parse_args()
+    if args.command == "record":
+        record(args)
+    else:
+        run(args)
+
+
+if __name__ == "__main__":
+    main()
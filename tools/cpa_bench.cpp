@@ -0,0 +1,102 @@
+// Host benchmark for the CPA kernel in src/cpa.cpp.
+//
+// Times computeCpa() per aircraft over random traffic of several sizes and
+// checks it against a floating-point reference of the same flat-earth model.
+//
+// Build and run:
+//   g++ -O2 -std=c++17 -Isrc tools/cpa_bench.cpp src/cpa.cpp -o cpa_bench
+//   ./cpa_bench
+//
+// Host numbers are for comparing kernel changes; on the device each fetch
+// logs the real cost ("CPA: N aircraft in M us").
+
+#include "cpa.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+static const float OBSERVER_LAT = 59.4f;
+static const float OBSERVER_LON = 24.8f;
+static const uint16_t HORIZON_S = 600;
+
+static std::vector<Aircraft> makeTraffic(int count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Aircraft> list(count);
+    for (Aircraft& a : list) {
+        a = Aircraft();
+        // Uniform over a 25 NM disc
+        float range = 25.0f * sqrtf(unit(rng));
+        float bearing = 2.0f * (float)M_PI * unit(rng);
+        float lat = OBSERVER_LAT + range / 60.0f * cosf(bearing);
+        float lon = OBSERVER_LON + range / 60.0f * sinf(bearing) /
+                    cosf(OBSERVER_LAT * (float)M_PI / 180.0f);
+        a.lat = lroundf(lat * 1e5f);
+        a.lon = lroundf(lon * 1e5f);
+        a.groundSpeed = 120 + (int)(unit(rng) * 400);
+        a.heading = (uint8_t)(unit(rng) * 256);
+        a.flags = unit(rng) < 0.95f ? AC_HEADING_VALID : 0;
+    }
+    return list;
+}
+
+// Same model in floating point, for the error check
+static void referenceCpa(const Aircraft& a, float& time, float& miss) {
+    const float nmPerDegLat = 60.0f;
+    const float nmPerDegLon = 60.0f * cosf(OBSERVER_LAT * (float)M_PI / 180.0f);
+    float rx = (a.lon / 1e5f - lroundf(OBSERVER_LON * 1e5f) / 1e5f) * nmPerDegLon;
+    float ry = (a.lat / 1e5f - lroundf(OBSERVER_LAT * 1e5f) / 1e5f) * nmPerDegLat;
+    time = 0;
+    miss = sqrtf(rx * rx + ry * ry);
+    if (!(a.flags & AC_HEADING_VALID) || a.groundSpeed == 0) return;
+
+    float track = a.heading * 2.0f * (float)M_PI / 256.0f;
+    float vx = a.groundSpeed / 3600.0f * sinf(track);  // NM/s
+    float vy = a.groundSpeed / 3600.0f * cosf(track);
+    float t = -(rx * vx + ry * vy) / (vx * vx + vy * vy);
+    if (t <= 0) return;
+    t = fminf(t, HORIZON_S);
+    time = t;
+    miss = sqrtf((rx + vx * t) * (rx + vx * t) + (ry + vy * t) * (ry + vy * t));
+}
+
+int main() {
+    CpaObserver obs = cpaObserver(OBSERVER_LAT, OBSERVER_LON, HORIZON_S);
+    std::mt19937 rng(1);
+
+    printf("%8s %12s %12s\n", "aircraft", "ns/aircraft", "approaching");
+    for (int count : {10, 30, 100, 300, 1000, 3000, 10000}) {
+        std::vector<Aircraft> list = makeTraffic(count, rng);
+        std::vector<AircraftCpa> out(count);
+
+        // Enough passes for ~20M aircraft per size
+        int passes = 20000000 / count;
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < passes; p++) {
+            computeCpa(obs, list.data(), count, out.data());
+            asm volatile("" : : "r"(out.data()) : "memory");
+        }
+        double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+
+        int approaching = 0;
+        for (const AircraftCpa& c : out) approaching += c.time > 0;
+        printf("%8d %12.2f %12d\n", count, ns / passes / count, approaching);
+    }
+
+    // Accuracy against the float model
+    std::vector<Aircraft> list = makeTraffic(10000, rng);
+    std::vector<AircraftCpa> out(list.size());
+    computeCpa(obs, list.data(), list.size(), out.data());
+    float worstMiss = 0, worstTime = 0;
+    for (size_t i = 0; i < list.size(); i++) {
+        float time, miss;
+        referenceCpa(list[i], time, miss);
+        worstMiss = fmaxf(worstMiss, fabsf(out[i].miss / 100.0f - miss));
+        worstTime = fmaxf(worstTime, fabsf(out[i].time - time));
+    }
+    printf("max error vs float: miss %.3f NM, time %.1f s\n", worstMiss, worstTime);
+    return 0;
+}
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Synthetic adsb.lol-style traffic for load testing.
+
+Writes one JSON document in the shape of /v2/point responses, with aircraft
+scattered around a centre point. Some records can drop optional fields, be
+ground vehicles or non-transponder sources, or carry wrong types and
+out-of-range values, so every branch of the device filter gets traffic.
+
+Usage: python3 tools/gen_traffic.py --count 1000 [--lat 59.4 --lon 24.8]
+       [--radius 25] [--missing-ratio 0.1] [--ground-ratio 0.05]
+       [--malformed-ratio 0.02] [--seed 1] [-o traffic.json]
+"""
+
+import argparse
+import json
+import math
+import random
+import sys
+import time
+
+AIRLINES = ["FIN", "BAW", "DLH", "AFR", "KLM", "SAS", "RYR", "EZY", "UAE", "THY"]
+TYPES = ["A320", "A321", "A359", "B738", "B77W", "E190", "AT76", "CRJ9", "B789", "A20N"]
+CATEGORIES = ["A1", "A2", "A3", "A5"]
+GROUND_CATEGORIES = ["C1", "C2", "C3"]
+
+# Optional fields a record may lose; hex is always present in the real feed
+OPTIONAL = ["flight", "r", "t", "category", "alt_baro", "baro_rate", "gs", "track"]
+
+
+def offset_position(lat, lon, distance_nm, bearing_deg):
+    """Point distance_nm from (lat, lon) along bearing_deg (flat-earth approximation)."""
+    d_lat = distance_nm / 60 * math.cos(math.radians(bearing_deg))
+    d_lon = distance_nm / 60 * math.sin(math.radians(bearing_deg)) / math.cos(math.radians(lat))
+    return lat + d_lat, lon + d_lon
+
+
+def airborne(rng, index, lat, lon, radius):
+    # Uniform over the disc
+    plat, plon = offset_position(lat, lon, radius * math.sqrt(rng.random()), rng.uniform(0, 360))
+    record = {
+        "hex": f"{rng.randrange(0x400000, 0x4fffff):06x}",
+        "type": "adsb_icao",
+        "flight": f"{rng.choice(AIRLINES)}{rng.randrange(1, 9999)}".ljust(8),
+        "r": f"OH-{chr(65 + index % 26)}{chr(65 + index // 26 % 26)}{chr(65 + index // 676 % 26)}",
+        "t": rng.choice(TYPES),
+        "category": rng.choice(CATEGORIES),
+        "alt_baro": rng.randrange(500, 41000, 25),
+        "baro_rate": rng.choice([0, 0, 0, rng.randrange(-2500, 2500, 64)]),
+        "gs": round(rng.uniform(120, 520), 1),
+        "track": round(rng.uniform(0, 360), 2),
+        "lat": round(plat, 6),
+        "lon": round(plon, 6),
+    }
+    if rng.random() < 0.05:
+        # MLAT/TIS-B style: speed only as TAS, non-ICAO address
+        record["tas"] = record.pop("gs")
+        record["hex"] = "~" + record["hex"]
+    return record
+
+
+def ground(rng, record):
+    if rng.random() < 0.5:
+        record["category"] = rng.choice(GROUND_CATEGORIES)
+    else:
+        record["type"] = "adsb_icao_nt"
+    record["alt_baro"] = "ground"
+    record["gs"] = round(rng.uniform(0, 30), 1)
+    return record
+
+
+def malform(rng, record):
+    field, value = rng.choice([
+        ("alt_baro", "high"),
+        ("alt_baro", 1e12),
+        ("gs", -50),
+        ("gs", 1e30),
+        ("track", "north"),
+        ("lat", 123.4),
+        ("lon", -999.0),
+        ("lat", None),
+        ("flight", 12345),
+        ("r", ["OH", "LVA"]),
+        ("hex", ""),
+        ("baro_rate", {"value": 64}),
+    ])
+    record[field] = value
+    return record
+
+
+def generate(args):
+    rng = random.Random(args.seed)
+    aircraft = []
+    for i in range(args.count):
+        record = airborne(rng, i, args.lat, args.lon, args.radius)
+        if rng.random() < args.ground_ratio:
+            record = ground(rng, record)
+        for field in OPTIONAL:
+            if rng.random() < args.missing_ratio:
+                record.pop(field, None)
+        if rng.random() < args.malformed_ratio:
+            record = malform(rng, record)
+        aircraft.append(record)
+
+    now_ms = int(time.time() * 1000)
+    return {
+        "ac": aircraft,
+        "msg": "No error",
+        "now": now_ms,
+        "total": len(aircraft),
+        "ctime": now_ms,
+        "ptime": 0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--count", type=int, default=100, help="aircraft records (10 to 10000)")
+    parser.add_argument("--lat", type=float, default=59.4)
+    parser.add_argument("--lon", type=float, default=24.8)
+    parser.add_argument("--radius", type=float, default=25, help="scatter radius in NM")
+    parser.add_argument("--missing-ratio", type=float, default=0.1,
+                        help="chance each optional field is dropped")
+    parser.add_argument("--ground-ratio", type=float, default=0.05,
+                        help="fraction of ground vehicles / non-transponder sources")
+    parser.add_argument("--malformed-ratio", type=float, default=0.02,
+                        help="fraction of records with a wrong type or impossible value")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    args = parser.parse_args()
+
+    if not 10 <= args.count <= 10000:
+        parser.error("--count must be between 10 and 10000")
+
+    payload = json.dumps(generate(args), separators=(",", ":"))
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(payload)
+    else:
+        sys.stdout.write(payload)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Local stand-in for the adsb.lol routeset endpoint.
+
+Answers POST /api/0/routeset with deterministic routes and logs each batch,
+so the route cache can be exercised without hitting the real API. Point
+ROUTE_API_URL in include/config.h at this machine, e.g.
+
+    #define ROUTE_API_URL "http://192.168.1.10:8080/api/0/routeset"
+
+Usage: python3 tools/route_server.py [--port 8080] [--unknown-ratio 0.2]
+"""
+
+import argparse
+import hashlib
+import json
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+AIRPORTS = ["LHR", "JFK", "CDG", "AMS", "FRA", "DXB", "HEL", "TLL", "ARN", "MAD"]
+
+
+def route_for(callsign, unknown_ratio):
+    digest = hashlib.sha1(callsign.encode()).digest()
+    if digest[0] / 255 < unknown_ratio:
+        return None
+    origin = AIRPORTS[digest[1] % len(AIRPORTS)]
+    destination = AIRPORTS[(digest[1] + 1 + digest[2] % (len(AIRPORTS) - 1)) % len(AIRPORTS)]
+    return f"{origin}-{destination}"
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.0"
+    unknown_ratio = 0.2
+    requests = 0
+    callsigns = 0
+
+    def do_POST(self):
+        if self.path != "/api/0/routeset":
+            self.send_error(404)
+            return
+
+        body = json.loads(self.rfile.read(int(self.headers["Content-Length"])))
+        planes = body.get("planes", [])
+
+        routes = []
+        for plane in planes:
+            codes = route_for(plane["callsign"], self.unknown_ratio)
+            if codes:
+                routes.append({
+                    "callsign": plane["callsign"],
+                    "_airport_codes_iata": codes,
+                    "plausible": True,
+                })
+
+        Handler.requests += 1
+        Handler.callsigns += len(planes)
+        print(f"batch {Handler.requests}: {len(planes)} callsigns, "
+              f"{len(routes)} routes ({Handler.callsigns} callsigns total)")
+
+        payload = json.dumps(routes).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(payload)))
+        self.end_headers()
+        self.wfile.write(payload)
+
+    def log_message(self, format, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--unknown-ratio", type=float, default=0.2,
+                        help="fraction of callsigns with no known route")
+    args = parser.parse_args()
+
+    Handler.unknown_ratio = args.unknown_ratio
+    server = HTTPServer(("", args.port), Handler)
+    print(f"routeset stand-in listening on :{args.port}")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
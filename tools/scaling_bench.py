@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Scaling benchmark for the aircraft pipeline, run on the device.
+
+For each traffic size, sends the serial "bench <bytes>" command followed by
+a payload from gen_traffic.py. The firmware runs its real parse, filter,
+geometry, sort and page render code and answers with one BENCH line. The
+results are written to a CSV file and plotted as time and memory curves.
+
+Traffic is generated around the device's own observer position and radius
+("bench observer"), so the filter keeps what it would keep in real use.
+--lat/--lon/--radius override them.
+
+Needs pyserial, and matplotlib for the plot.
+
+Usage: python3 tools/scaling_bench.py --port /dev/ttyACM0
+       [--sizes 10,30,100,300,1000,3000,10000] [--repeat 3]
+       [--lat 59.4 --lon 24.8 --radius 25] [--csv bench.csv] [--plot bench.png]
+"""
+
+import argparse
+import csv
+import json
+import os
+import sys
+from types import SimpleNamespace
+
+import serial
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import bench_serial  # noqa: E402
+import gen_traffic  # noqa: E402
+
+STAGES = ["parse_us", "filter_us", "geometry_us", "cpa_us", "sort_us", "render_us", "compose_us"]
+FIELDS = ["size", "run", "records", "kept", "bytes"] + STAGES + ["heap_peak", "heap_free", "error"]
+
+
+def query_observer(port, timeout):
+    bench_serial.send(port, "bench observer")
+    line = bench_serial.wait_for(port, "BENCH observer ", timeout)
+    fields = dict(item.split("=", 1) for item in line.split()[2:])
+    return float(fields["lat"]), float(fields["lon"]), float(fields["radius"])
+
+
+def run_one(port, payload, timeout):
+    return bench_serial.run(port, f"bench {len(payload)}", payload, "BENCH ", timeout)
+
+
+def plot(rows, path):
+    import matplotlib
+    matplotlib.use("Agg")
+    import matplotlib.pyplot as plt
+
+    sizes = sorted({r["size"] for r in rows})
+
+    def median(size, field):
+        values = sorted(int(r[field]) for r in rows if r["size"] == size and r["error"] == "none")
+        return values[len(values) // 2] if values else float("nan")
+
+    fig, (times, memory) = plt.subplots(1, 2, figsize=(12, 5))
+    for stage in STAGES:
+        times.plot(sizes, [median(s, stage) / 1000 for s in sizes], marker="o", label=stage[:-3])
+    times.set(xscale="log", yscale="log", xlabel="aircraft in payload", ylabel="ms",
+              title="Stage time")
+    times.legend()
+
+    memory.plot(sizes, [median(s, "heap_peak") / 1024 for s in sizes], marker="o", label="parse peak")
+    memory.plot(sizes, [median(s, "heap_free") / 1024 for s in sizes], marker="o", label="free after render")
+    memory.set(xscale="log", xlabel="aircraft in payload", ylabel="KB", title="Heap")
+    memory.legend()
+
+    fig.tight_layout()
+    fig.savefig(path)
+    print(f"Plot written to {path}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", required=True, help="device serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--sizes", default="10,30,100,300,1000,3000,10000")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per size")
+    parser.add_argument("--lat", type=float, help="traffic centre (default: device position)")
+    parser.add_argument("--lon", type=float)
+    parser.add_argument("--radius", type=float, help="scatter radius in NM (default: device radius)")
+    parser.add_argument("--missing-ratio", type=float, default=0.1)
+    parser.add_argument("--ground-ratio", type=float, default=0.05)
+    parser.add_argument("--malformed-ratio", type=float, default=0.02)
+    parser.add_argument("--timeout", type=float, default=60, help="seconds to wait per run")
+    parser.add_argument("--csv", default="bench.csv")
+    parser.add_argument("--plot", default="bench.png")
+    args = parser.parse_args()
+
+    rows = []
+    with serial.Serial(args.port, args.baud, timeout=1) as port:
+        lat, lon, radius = query_observer(port, 10)
+        lat = lat if args.lat is None else args.lat
+        lon = lon if args.lon is None else args.lon
+        radius = radius if args.radius is None else args.radius
+        print(f"Traffic around {lat:.4f}, {lon:.4f} within {radius:g} NM")
+
+        for size in [int(s) for s in args.sizes.split(",")]:
+            for run in range(args.repeat):
+                traffic = SimpleNamespace(count=size, lat=lat, lon=lon, radius=radius,
+                                          missing_ratio=args.missing_ratio,
+                                          ground_ratio=args.ground_ratio,
+                                          malformed_ratio=args.malformed_ratio,
+                                          seed=run + 1)
+                payload = json.dumps(gen_traffic.generate(traffic), separators=(",", ":")).encode()
+                result = run_one(port, payload, args.timeout)
+                result.update(size=size, run=run)
+                rows.append(result)
+                print(f"{size:>6} aircraft: kept {result['kept']}, "
+                      f"parse {int(result['parse_us']) / 1000:.1f} ms, "
+                      f"render {int(result['render_us']) / 1000:.1f} ms, "
+                      f"peak heap {int(result['heap_peak'])} B, error {result['error']}")
+
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"Results written to {args.csv}")
+
+    plot(rows, args.plot)
+
+
+if __name__ == "__main__":
+    main()